@@ -0,0 +1,106 @@
+#include "Benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+#include "HierarchicalIndex.h"
+
+//Average milliseconds taken by solve over the given number of runs, resetting the maze each time
+template <class Solve>
+static double timeSolve(Maze &maze, int repeats, Solve solve)
+{
+	double total = 0.0;
+
+	for (int i = 0; i < repeats; i++)
+	{
+		maze.reset();
+
+		auto start = std::chrono::steady_clock::now();
+		solve();
+		total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	return total / repeats;
+}
+
+void runBenchmark(Maze &maze, int repeats)
+{
+	const char *neighbourhoods[] = { "4-connected", "8-connected" };
+	const char *stops[] = { "first target", "all targets", "full field" };
+	const char *layouts[] = { "node", "compact" };
+
+	std::cout << "Benchmarking a " << maze.getX() << "x" << maze.getY() << " maze, average of " << repeats << " runs." << std::endl;
+
+	int steps = 0;
+	double generic = timeSolve(maze, repeats, [&]()
+	{
+		while (maze.stepProcess());
+		steps = maze.getSteps();
+	});
+
+	std::cout << std::left << std::setw(40) << "generic stepProcess" << std::fixed << std::setprecision(3) << std::setw(12) << generic << "ms  " << steps << " steps" << std::endl;
+
+	for (int n = 0; n < 2; n++)
+	{
+		for (int s = 0; s < 3; s++)
+		{
+			for (int l = 0; l < 2; l++)
+			{
+				double time = timeSolve(maze, repeats, [&]()
+				{
+					steps = maze.process(Maze::Neighbourhood(n), Maze::StopPolicy(s), Maze::StateLayout(l));
+				});
+
+				std::string name = std::string(neighbourhoods[n]) + ", " + stops[s] + ", " + layouts[l];
+				std::cout << std::left << std::setw(40) << name << std::setw(12) << time << "ms  " << steps << " steps";
+
+				//Only the first target kernels do the same work as the generic search
+				if (s == Maze::StopPolicy::FIRST_TARGET && n == Maze::Neighbourhood::FOUR_CONNECTED) std::cout << "  " << std::setprecision(1) << generic / time << "x faster" << std::setprecision(3);
+				std::cout << std::endl;
+			}
+		}
+	}
+
+	maze.reset();
+
+	//Queries between random open cells, the same ones every run so results compare
+	const int queries = 100;
+	std::vector<int> open;
+	TypeView view = maze.getView();
+	for (int i = 0; i < maze.getX(); i++)
+	{
+		int o = 0;
+		for (Node::Type type : view.column(i))
+		{
+			if (type != Node::Type::WALL) open.push_back(i * maze.getY() + o);
+			o++;
+		}
+	}
+	if (open.size() == 0) return;
+
+	HierarchicalIndex index(maze);
+
+	auto start = std::chrono::steady_clock::now();
+	index.build();
+	double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::mt19937 random(1);
+	long long touched = 0;
+	long long expanded = 0;
+	long long relaxed = 0;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < queries; i++)
+	{
+		int from = open[random() % open.size()];
+		int to = open[random() % open.size()];
+		index.distance(from / maze.getY(), from % maze.getY(), to / maze.getY(), to % maze.getY());
+		touched += index.getTouchedCells();
+		expanded += index.getExpandedCrossings();
+		relaxed += index.getRelaxedEdges();
+	}
+	double queryTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / queries;
+
+	std::cout << std::left << std::setw(40) << "hierarchical index build" << std::setw(12) << buildTime << "ms  " << index.getCrossingCount() << " crossings" << std::endl;
+	std::cout << std::left << std::setw(40) << "hierarchical index query" << std::setw(12) << queryTime << "ms  " << touched / queries << " cells touched of " << (long long)maze.getX() * maze.getY() << ", " << expanded / queries << " crossings expanded, " << relaxed / queries << " edges relaxed" << std::endl;
+}
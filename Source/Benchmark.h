@@ -0,0 +1,10 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Maze.h"
+
+//Times every specialised solver kernel against the generic stepping search on the same maze
+//Then builds a hierarchical index and times random queries on it
+void runBenchmark(Maze &maze, int repeats);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <glm/vec3.hpp>
+
+#include "Maze.h"
+
+//Shared between the live window and the image exporter so both show the same picture
+inline glm::vec3 getColor(Node::Type type)
+{
+	switch (type)
+	{
+	case Node::Type::SEARCHED:
+		return glm::vec3(0.0, 0.4, 0.0);
+
+	case Node::Type::START:
+		return glm::vec3(0.0, 1.0, 0.25);
+
+	case Node::Type::TARGET:
+		return glm::vec3(1.0, 0.65, 0.0);
+
+	case Node::Type::TRACED:
+		return glm::vec3(0.1, 0.6, 1.0);
+
+	case Node::Type::UNSEARCHED:
+		return glm::vec3(1.0, 1.0, 1.0);
+
+	case Node::Type::WALL:
+		return glm::vec3(0.2, 0.2, 0.2);
+	}
+
+	return glm::vec3(0.0, 0.0, 0.0);
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "Connectivity.h"
+
+#include <algorithm>
+
+#include "Maze.h"
+#include "SolverWorkspace.h"
+#include "WorkerPool.h"
+
+//Union-find over cell indices, each root holds the size of its set
+static int findRoot(std::vector<int> &parent, int i)
+{
+	//Path halving keeps the trees shallow without a second pass
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+
+	return i;
+}
+
+static void join(std::vector<int> &parent, std::vector<int> &size, int a, int b)
+{
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a == b) return;
+
+	//The smaller set goes under the larger one
+	if (size[a] < size[b]) std::swap(a, b);
+	parent[b] = a;
+	size[a] += size[b];
+}
+
+void Connectivity::build(const Maze &maze, SolverWorkspace &ws, int threads)
+{
+	int xSize = maze.getX();
+	_ySize = maze.getY();
+	size_t count = (size_t)xSize * _ySize;
+
+	if (threads <= 0) threads = WorkerPool::shared().getThreadCount();
+	threads = std::max(1, std::min(threads, xSize));
+
+	TypeView view = maze.getView();
+
+	//The scratch lives in the workspace, only the labels and sizes kept here are counted by hand
+	size_t labelCapacity = _labels.capacity();
+	size_t sizeCapacity = _sizes.capacity();
+
+	std::vector<int> &parent = ws.parents;
+	std::vector<int> &size = ws.setSizes;
+	parent.resize(count);
+	size.assign(count, 1);
+	_labels.resize(count);
+
+	//Columns are contiguous, so each thread takes a strip of whole columns
+	std::vector<int> &stripStart = ws.strips;
+	stripStart.resize(threads + 1);
+	for (int t = 0; t <= threads; t++)
+	{
+		stripStart[t] = (int)((long long)xSize * t / threads);
+	}
+
+	//Open cells, edges and roots found by each strip
+	std::vector<long long> &stripCounts = ws.stripCounts;
+	stripCounts.assign((size_t)threads * 3, 0);
+	long long *cells = stripCounts.data();
+	long long *edges = cells + threads;
+	long long *roots = edges + threads;
+
+	//Every thread joins cells inside its own strip only, so no two threads touch the same set
+	WorkerPool::shared().run(threads, [&](int t)
+	{
+		for (int i = stripStart[t]; i < stripStart[t + 1]; i++)
+		{
+			for (int o = 0; o < _ySize; o++)
+			{
+				int cell = i * _ySize + o;
+				parent[cell] = cell;
+				if (view(i, o) == Node::Type::WALL) continue;
+
+				cells[t]++;
+
+				if (o > 0 && view(i, o - 1) != Node::Type::WALL)
+				{
+					join(parent, size, cell, cell - 1);
+					edges[t]++;
+				}
+
+				if (i > stripStart[t] && view(i - 1, o) != Node::Type::WALL)
+				{
+					join(parent, size, cell, cell - _ySize);
+					edges[t]++;
+				}
+			}
+		}
+	});
+
+	_cells = 0;
+	_edges = 0;
+	for (int t = 0; t < threads; t++)
+	{
+		_cells += cells[t];
+		_edges += edges[t];
+	}
+
+	//Stitch the strips together along the column each one starts on
+	for (int t = 1; t < threads; t++)
+	{
+		int i = stripStart[t];
+		for (int o = 0; o < _ySize; o++)
+		{
+			if (view(i, o) == Node::Type::WALL || view(i - 1, o) == Node::Type::WALL) continue;
+
+			join(parent, size, i * _ySize + o, (i - 1) * _ySize + o);
+			_edges++;
+		}
+	}
+
+	//Point every cell at its root without compressing, as roots can now be in any strip
+	WorkerPool::shared().run(threads, [&](int t)
+	{
+		for (int i = stripStart[t]; i < stripStart[t + 1]; i++)
+		{
+			int cell = i * _ySize;
+			for (Node::Type type : view.column(i))
+			{
+				if (type == Node::Type::WALL) _labels[cell] = -1;
+				else
+				{
+					int root = cell;
+					while (parent[root] != root) root = parent[root];
+
+					_labels[cell] = root;
+					if (root == cell) roots[t]++;
+				}
+
+				cell++;
+			}
+		}
+	});
+
+	//Components are numbered in cell order, each strip starting after the ones before it
+	long long components = 0;
+	for (int t = 0; t < threads; t++)
+	{
+		long long strip = roots[t];
+		roots[t] = components;
+		components += strip;
+	}
+
+	_sizes.resize((size_t)components);
+
+	//The parent of a root isn't needed any more, so it is reused to hold the root's component
+	WorkerPool::shared().run(threads, [&](int t)
+	{
+		int id = (int)roots[t];
+		for (int cell = stripStart[t] * _ySize; cell < stripStart[t + 1] * _ySize; cell++)
+		{
+			if (_labels[cell] != cell) continue;
+
+			_sizes[id] = size[cell];
+			parent[cell] = id++;
+		}
+	});
+
+	std::vector<std::vector<int>> &startComponents = ws.stripStarts;
+	std::vector<std::vector<int>> &targetComponents = ws.stripTargets;
+	if ((int)startComponents.size() < threads) startComponents.resize(threads);
+	if ((int)targetComponents.size() < threads) targetComponents.resize(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		startComponents[t].clear();
+		targetComponents[t].clear();
+	}
+
+	WorkerPool::shared().run(threads, [&](int t)
+	{
+		for (int i = stripStart[t]; i < stripStart[t + 1]; i++)
+		{
+			int cell = i * _ySize;
+			for (Node::Type type : view.column(i))
+			{
+				if (type != Node::Type::WALL) _labels[cell] = parent[_labels[cell]];
+
+				if (type == Node::Type::START) startComponents[t].push_back(_labels[cell]);
+				else if (type == Node::Type::TARGET) targetComponents[t].push_back(_labels[cell]);
+
+				cell++;
+			}
+		}
+	});
+
+	std::vector<unsigned char> &hasStart = ws.componentFlags;
+	hasStart.assign(_sizes.size(), 0);
+	for (int t = 0; t < threads; t++)
+	{
+		for (int component : startComponents[t])
+		{
+			hasStart[component] = 1;
+		}
+	}
+
+	_startsReachTargets = false;
+	for (int t = 0; t < threads; t++)
+	{
+		for (int component : targetComponents[t])
+		{
+			if (hasStart[component]) _startsReachTargets = true;
+		}
+	}
+
+	if (_labels.capacity() != labelCapacity) ws.countAllocation();
+	if (_sizes.capacity() != sizeCapacity) ws.countAllocation();
+	ws.track();
+
+	_valid = true;
+}
+
+void Connectivity::clear()
+{
+	_labels.clear();
+	_sizes.clear();
+	_cells = 0;
+	_edges = 0;
+	_startsReachTargets = false;
+	_valid = false;
+}
+
+bool Connectivity::connected(int x1, int y1, int x2, int y2) const
+{
+	int component = getComponent(x1, y1);
+
+	return component != -1 && component == getComponent(x2, y2);
+}
@@ -0,0 +1,53 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <cstddef>
+#include <vector>
+
+class Maze;
+class SolverWorkspace;
+
+//Splits the open cells of a maze into connected components with a parallel union-find
+//Answers whether any path can exist without searching, so unsolvable mazes are rejected in a single pass
+class Connectivity
+{
+public:
+	//Labels every cell, run again whenever walls, starts or targets change
+	//The union-find scratch comes from the workspace, so a warm workspace only allocates if the maze grew
+	void build(const Maze &maze, SolverWorkspace &ws, int threads = 0);
+	//Forgets the last build, isValid is false until the next one
+	void clear();
+
+	bool isValid() const { return _valid; }
+
+	//Component of a cell, -1 for walls
+	int getComponent(int x, int y) const { return _labels[(size_t)x * _ySize + y]; }
+	int getComponentCount() const { return (int)_sizes.size(); }
+	long long getSize(int component) const { return _sizes[component]; }
+	const std::vector<long long> &getSizes() const { return _sizes; }
+
+	bool connected(int x1, int y1, int x2, int y2) const;
+	//True if any start shares a component with any target, searching straight moves can't succeed otherwise
+	bool startsReachTargets() const { return _startsReachTargets; }
+
+	//Open cells joined by more than one route, found from the edge, cell and component counts
+	bool hasCycles() const { return _edges - _cells + getComponentCount() > 0; }
+	//Every open cell is reachable from every other by exactly one route
+	bool isPerfect() const { return getComponentCount() == 1 && !hasCycles(); }
+
+	long long getCellCount() const { return _cells; }
+	long long getEdgeCount() const { return _edges; }
+
+private:
+	int _ySize = 0;
+
+	std::vector<int> _labels;
+	std::vector<long long> _sizes;
+
+	long long _cells = 0;
+	long long _edges = 0;
+	bool _startsReachTargets = false;
+	bool _valid = false;
+};
+
+#endif
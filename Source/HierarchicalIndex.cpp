@@ -0,0 +1,520 @@
+#include "HierarchicalIndex.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#include "WorkerPool.h"
+
+//Openings at least this wide only get crossings at their two ends
+const int wideOpening = 4;
+
+//Straight moves in the order north, south, east, west, with the direction leading back
+const int moveDx[4] = { 0, 0, 1, -1 };
+const int moveDy[4] = { -1, 1, 0, 0 };
+const Node::Direction moveDirections[4] = { Node::Direction::NORTH, Node::Direction::SOUTH, Node::Direction::EAST, Node::Direction::WEST };
+const Node::Direction moveBack[4] = { Node::Direction::SOUTH, Node::Direction::NORTH, Node::Direction::WEST, Node::Direction::EAST };
+
+typedef std::greater<std::pair<int, int>> HeapOrder;
+
+HierarchicalIndex::HierarchicalIndex(const Maze &maze, int clusterSize) : _maze(maze), _clusterSize(std::max(2, clusterSize))
+{
+}
+
+int HierarchicalIndex::clusterOf(int x, int y) const
+{
+	return (x / _clusterSize) * _clustersY + y / _clusterSize;
+}
+
+int HierarchicalIndex::localIndex(const Cluster &cluster, int cell) const
+{
+	int x = cell / _maze.getY();
+	int y = cell % _maze.getY();
+
+	return (x - cluster.x) * cluster.height + (y - cluster.y);
+}
+
+void HierarchicalIndex::build()
+{
+	_layoutVersion = _maze.getLayoutVersion();
+
+	_clustersX = (_maze.getX() + _clusterSize - 1) / _clusterSize;
+	_clustersY = (_maze.getY() + _clusterSize - 1) / _clusterSize;
+	int count = _clustersX * _clustersY;
+
+	_clusters.assign(count, Cluster());
+	_southCrossings.assign(count, std::vector<int>());
+	_eastCrossings.assign(count, std::vector<int>());
+
+	for (int i = 0; i < count; i++)
+	{
+		Cluster &cluster = _clusters[i];
+		cluster.x = i / _clustersY * _clusterSize;
+		cluster.y = i % _clustersY * _clusterSize;
+		cluster.width = std::min(_clusterSize, _maze.getX() - cluster.x);
+		cluster.height = std::min(_clusterSize, _maze.getY() - cluster.y);
+	}
+
+	//Every border belongs to the cluster above or left of it, so each is only found once
+	WorkerPool::shared().forEach(count, [&](int i)
+	{
+		findCrossings(i, true);
+		findCrossings(i, false);
+	});
+
+	//Clusters only read their neighbours' borders, so they can all be built at once
+	WorkerPool::shared().forEachWith<Search>(count, [&](int i, Search &search)
+	{
+		buildCluster(i, search);
+	});
+
+	numberCrossings();
+}
+
+void HierarchicalIndex::numberCrossings()
+{
+	_firstCrossing.resize(_clusters.size() + 1);
+	_firstCrossing[0] = 0;
+	for (size_t i = 0; i < _clusters.size(); i++)
+	{
+		_firstCrossing[i + 1] = _firstCrossing[i] + _clusters[i].cells.size();
+	}
+
+	int total = _firstCrossing.back();
+	_crossingCluster.resize(total);
+	for (size_t i = 0; i < _clusters.size(); i++)
+	{
+		std::fill(_crossingCluster.begin() + _firstCrossing[i], _crossingCluster.begin() + _firstCrossing[i + 1], (int)i);
+	}
+
+	_visitCost.resize(total);
+	_visitPrevious.resize(total);
+	_visitStamp.assign(total, 0);
+	_stamp = 0;
+}
+
+int HierarchicalIndex::crossingCell(int crossing) const
+{
+	int cluster = _crossingCluster[crossing];
+
+	return _clusters[cluster].cells[crossing - _firstCrossing[cluster]];
+}
+
+void HierarchicalIndex::findCrossings(int cluster, bool south)
+{
+	const Cluster &current = _clusters[cluster];
+
+	std::vector<int> &crossings = south ? _southCrossings[cluster] : _eastCrossings[cluster];
+	crossings.clear();
+
+	//Clusters on the far edges have nothing beyond them
+	if (south ? cluster % _clustersY == _clustersY - 1 : cluster / _clustersY == _clustersX - 1) return;
+
+	int length = south ? current.width : current.height;
+	int runStart = -1;
+	for (int i = 0; i <= length; i++)
+	{
+		bool open = false;
+		if (i < length)
+		{
+			int x = south ? current.x + i : current.x + current.width - 1;
+			int y = south ? current.y + current.height - 1 : current.y + i;
+			open = _maze.getType(x, y) != Node::Type::WALL && _maze.getType(south ? x : x + 1, south ? y + 1 : y) != Node::Type::WALL;
+		}
+
+		if (open)
+		{
+			if (runStart == -1) runStart = i;
+			continue;
+		}
+
+		if (runStart == -1) continue;
+
+		if (i - runStart < wideOpening)
+		{
+			for (int o = runStart; o < i; o++)
+			{
+				crossings.push_back(o);
+			}
+		}
+		else
+		{
+			crossings.push_back(runStart);
+			crossings.push_back(i - 1);
+		}
+
+		runStart = -1;
+	}
+}
+
+void HierarchicalIndex::buildCluster(int cluster, Search &search)
+{
+	Cluster &current = _clusters[cluster];
+	int ySize = _maze.getY();
+
+	//North and west crossings are stored on the borders of the clusters above and to the left
+	current.cells.clear();
+	current.sideStart[Side::NORTH] = 0;
+	if (cluster % _clustersY > 0)
+	{
+		for (int offset : _southCrossings[cluster - 1])
+		{
+			current.cells.push_back((current.x + offset) * ySize + current.y);
+		}
+	}
+
+	current.sideStart[Side::SOUTH] = current.cells.size();
+	for (int offset : _southCrossings[cluster])
+	{
+		current.cells.push_back((current.x + offset) * ySize + current.y + current.height - 1);
+	}
+
+	current.sideStart[Side::EAST] = current.cells.size();
+	for (int offset : _eastCrossings[cluster])
+	{
+		current.cells.push_back((current.x + current.width - 1) * ySize + current.y + offset);
+	}
+
+	current.sideStart[Side::WEST] = current.cells.size();
+	if (cluster / _clustersY > 0)
+	{
+		for (int offset : _eastCrossings[cluster - _clustersY])
+		{
+			current.cells.push_back(current.x * ySize + current.y + offset);
+		}
+	}
+
+	current.sideStart[4] = current.cells.size();
+
+	size_t count = current.cells.size();
+	current.costs.assign(count * count, -1);
+	for (size_t i = 0; i < count; i++)
+	{
+		searchCluster(cluster, current.cells[i], false, search);
+
+		for (size_t o = 0; o < count; o++)
+		{
+			current.costs[i * count + o] = search.cost[localIndex(current, current.cells[o])];
+		}
+	}
+}
+
+void HierarchicalIndex::searchCluster(int cluster, int cell, bool reverse, Search &search) const
+{
+	const Cluster &current = _clusters[cluster];
+
+	search.cost.assign((size_t)current.width * current.height, -1);
+	search.parent.assign((size_t)current.width * current.height, Node::Direction::NONE);
+	search.heap.clear();
+	search.touched = 0;
+
+	int first = localIndex(current, cell);
+	search.cost[first] = 0;
+	search.heap.push_back(std::make_pair(0, first));
+
+	while (search.heap.size() != 0)
+	{
+		std::pop_heap(search.heap.begin(), search.heap.end(), HeapOrder());
+		int cost = search.heap.back().first;
+		int local = search.heap.back().second;
+		search.heap.pop_back();
+
+		if (cost > search.cost[local]) continue;
+		search.touched++;
+
+		int x = current.x + local / current.height;
+		int y = current.y + local % current.height;
+
+		//Going the right way, a reversed search steps onto the cell it is leaving
+		int leaving = reverse ? _maze.getWeight(x, y) : 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			int nextX = x + moveDx[i];
+			int nextY = y + moveDy[i];
+			if (nextX < current.x || nextY < current.y || nextX >= current.x + current.width || nextY >= current.y + current.height) continue;
+			if (_maze.getType(nextX, nextY) == Node::Type::WALL) continue;
+
+			int nextCost = cost + (reverse ? leaving : _maze.getWeight(nextX, nextY));
+			int next = (nextX - current.x) * current.height + (nextY - current.y);
+			if (search.cost[next] != -1 && search.cost[next] <= nextCost) continue;
+
+			search.cost[next] = nextCost;
+			search.parent[next] = moveBack[i];
+			search.heap.push_back(std::make_pair(nextCost, next));
+			std::push_heap(search.heap.begin(), search.heap.end(), HeapOrder());
+		}
+	}
+}
+
+void HierarchicalIndex::partner(int cluster, int crossing, int &otherCluster, int &otherCrossing) const
+{
+	const Cluster &current = _clusters[cluster];
+
+	int side = Side::NORTH;
+	while (crossing >= current.sideStart[side + 1]) side++;
+
+	//Both sides of a border are built from the same list, so crossings pair up by position
+	int position = crossing - current.sideStart[side];
+	switch (side)
+	{
+	case Side::NORTH:
+		otherCluster = cluster - 1;
+		otherCrossing = _clusters[otherCluster].sideStart[Side::SOUTH] + position;
+		break;
+
+	case Side::SOUTH:
+		otherCluster = cluster + 1;
+		otherCrossing = _clusters[otherCluster].sideStart[Side::NORTH] + position;
+		break;
+
+	case Side::EAST:
+		otherCluster = cluster + _clustersY;
+		otherCrossing = _clusters[otherCluster].sideStart[Side::WEST] + position;
+		break;
+
+	default:
+		otherCluster = cluster - _clustersY;
+		otherCrossing = _clusters[otherCluster].sideStart[Side::EAST] + position;
+		break;
+	}
+}
+
+void HierarchicalIndex::appendMoves(const Cluster &cluster, const Search &search, int from, int to, std::vector<Node::Direction> &moves) const
+{
+	size_t first = moves.size();
+
+	//Parents lead back to where the search started, so the moves come out reversed and flipped
+	int ySize = _maze.getY();
+	for (int cell = to; cell != from;)
+	{
+		Node::Direction parent = Node::Direction(search.parent[localIndex(cluster, cell)]);
+		int i = std::find(moveDirections, moveDirections + 4, parent) - moveDirections;
+
+		moves.push_back(moveBack[i]);
+		cell += moveDx[i] * ySize + moveDy[i];
+	}
+
+	std::reverse(moves.begin() + first, moves.end());
+}
+
+int HierarchicalIndex::distance(int startX, int startY, int targetX, int targetY)
+{
+	return query(startX, startY, targetX, targetY, nullptr);
+}
+
+int HierarchicalIndex::findPath(int startX, int startY, int targetX, int targetY, Path &path)
+{
+	return query(startX, startY, targetX, targetY, &path);
+}
+
+int HierarchicalIndex::query(int startX, int startY, int targetX, int targetY, Path *path)
+{
+	if (_maze.getLayoutVersion() != _layoutVersion || _clusters.size() == 0) build();
+
+	_touched = 0;
+	_expanded = 0;
+	_relaxed = 0;
+	if (path) path->clear(startX, startY);
+
+	if (startX < 0 || startY < 0 || startX >= _maze.getX() || startY >= _maze.getY()) return -1;
+	if (targetX < 0 || targetY < 0 || targetX >= _maze.getX() || targetY >= _maze.getY()) return -1;
+	if (_maze.getType(startX, startY) == Node::Type::WALL || _maze.getType(targetX, targetY) == Node::Type::WALL) return -1;
+
+	int ySize = _maze.getY();
+	int startCell = startX * ySize + startY;
+	int targetCell = targetX * ySize + targetY;
+	int startCluster = clusterOf(startX, startY);
+	int targetCluster = clusterOf(targetX, targetY);
+
+	//Only the clusters at the two ends are searched cell by cell
+	searchCluster(startCluster, startCell, false, _startSearch);
+	searchCluster(targetCluster, targetCell, true, _targetSearch);
+	_touched = _startSearch.touched + _targetSearch.touched;
+
+	const Cluster &first = _clusters[startCluster];
+	const Cluster &last = _clusters[targetCluster];
+
+	//A route that never leaves a shared cluster is already known, though one that leaves might still be cheaper
+	int best = startCluster == targetCluster ? _startSearch.cost[localIndex(first, targetCell)] : -1;
+	int bestCrossing = -1;
+
+	//Visits from earlier queries are told apart by their stamp, so nothing needs clearing between queries
+	if (++_stamp == 0)
+	{
+		std::fill(_visitStamp.begin(), _visitStamp.end(), 0);
+		_stamp = 1;
+	}
+
+	std::vector<std::pair<int, int>> &heap = _heap;
+	heap.clear();
+
+	//Every move costs at least 1, so the straight line distance never overestimates what is left
+	auto estimate = [&](int crossing)
+	{
+		int cell = crossingCell(crossing);
+		return std::abs(cell / ySize - targetX) + std::abs(cell % ySize - targetY);
+	};
+
+	auto relax = [&](int crossing, int cost, int previous)
+	{
+		_relaxed++;
+		if (_visitStamp[crossing] == _stamp && _visitCost[crossing] <= cost) return;
+
+		_visitStamp[crossing] = _stamp;
+		_visitCost[crossing] = cost;
+		_visitPrevious[crossing] = previous;
+		heap.push_back(std::make_pair(cost + estimate(crossing), crossing));
+		std::push_heap(heap.begin(), heap.end(), HeapOrder());
+	};
+
+	for (size_t i = 0; i < first.cells.size(); i++)
+	{
+		int cost = _startSearch.cost[localIndex(first, first.cells[i])];
+		if (cost != -1) relax(_firstCrossing[startCluster] + i, cost, -1);
+	}
+
+	while (heap.size() != 0)
+	{
+		std::pop_heap(heap.begin(), heap.end(), HeapOrder());
+		int bound = heap.back().first;
+		int crossing = heap.back().second;
+		heap.pop_back();
+
+		if (best != -1 && bound >= best) break;
+
+		int cost = _visitCost[crossing];
+		if (bound > cost + estimate(crossing)) continue;
+
+		_expanded++;
+
+		int cluster = _crossingCluster[crossing];
+		int index = crossing - _firstCrossing[cluster];
+		const Cluster &current = _clusters[cluster];
+
+		if (cluster == targetCluster)
+		{
+			int rest = _targetSearch.cost[localIndex(current, current.cells[index])];
+			if (rest != -1 && (best == -1 || cost + rest < best))
+			{
+				best = cost + rest;
+				bestCrossing = crossing;
+			}
+		}
+
+		size_t count = current.cells.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			int step = current.costs[index * count + i];
+			if ((int)i == index || step == -1) continue;
+
+			relax(_firstCrossing[cluster] + i, cost + step, crossing);
+		}
+
+		int otherCluster;
+		int otherIndex;
+		partner(cluster, index, otherCluster, otherIndex);
+
+		int otherCell = _clusters[otherCluster].cells[otherIndex];
+		relax(_firstCrossing[otherCluster] + otherIndex, cost + _maze.getWeight(otherCell / ySize, otherCell % ySize), crossing);
+	}
+
+	if (!path || best == -1) return best;
+
+	std::vector<Node::Direction> moves;
+	if (bestCrossing == -1) appendMoves(first, _startSearch, startCell, targetCell, moves);
+	else
+	{
+		std::vector<int> route;
+		for (int crossing = bestCrossing; crossing != -1; crossing = _visitPrevious[crossing])
+		{
+			route.push_back(crossing);
+		}
+		std::reverse(route.begin(), route.end());
+
+		int cell = crossingCell(route[0]);
+		appendMoves(first, _startSearch, startCell, cell, moves);
+
+		//Only the clusters the route passes through are searched again
+		for (size_t i = 1; i < route.size(); i++)
+		{
+			int cluster = _crossingCluster[route[i]];
+			int next = crossingCell(route[i]);
+
+			if (cluster != _crossingCluster[route[i - 1]])
+			{
+				int dx = next / ySize - cell / ySize;
+				int dy = next % ySize - cell % ySize;
+				moves.push_back(dx > 0 ? Node::Direction::EAST : dx < 0 ? Node::Direction::WEST : dy > 0 ? Node::Direction::SOUTH : Node::Direction::NORTH);
+			}
+			else if (next != cell)
+			{
+				searchCluster(cluster, cell, false, _refineSearch);
+				_touched += _refineSearch.touched;
+				appendMoves(_clusters[cluster], _refineSearch, cell, next, moves);
+			}
+
+			cell = next;
+		}
+
+		//The reversed search's parents already lead towards the target
+		while (cell != targetCell)
+		{
+			Node::Direction parent = Node::Direction(_targetSearch.parent[localIndex(last, cell)]);
+			int i = std::find(moveDirections, moveDirections + 4, parent) - moveDirections;
+
+			moves.push_back(parent);
+			cell += moveDx[i] * ySize + moveDy[i];
+		}
+	}
+
+	for (Node::Direction move : moves)
+	{
+		path->push(move);
+	}
+
+	return best;
+}
+
+void HierarchicalIndex::update(int x, int y)
+{
+	if (_maze.getLayoutVersion() != _layoutVersion || _clusters.size() == 0)
+	{
+		build();
+		return;
+	}
+
+	int cluster = clusterOf(x, y);
+	const Cluster &current = _clusters[cluster];
+
+	//A cell on the edge of its cluster can open or close a crossing, which changes the neighbour as well
+	std::vector<int> rebuild(1, cluster);
+	if (x == current.x && cluster / _clustersY > 0)
+	{
+		findCrossings(cluster - _clustersY, false);
+		rebuild.push_back(cluster - _clustersY);
+	}
+	if (x == current.x + current.width - 1 && cluster / _clustersY < _clustersX - 1)
+	{
+		findCrossings(cluster, false);
+		rebuild.push_back(cluster + _clustersY);
+	}
+	if (y == current.y && cluster % _clustersY > 0)
+	{
+		findCrossings(cluster - 1, true);
+		rebuild.push_back(cluster - 1);
+	}
+	if (y == current.y + current.height - 1 && cluster % _clustersY < _clustersY - 1)
+	{
+		findCrossings(cluster, true);
+		rebuild.push_back(cluster + 1);
+	}
+
+	for (int i : rebuild)
+	{
+		buildCluster(i, _refineSearch);
+	}
+
+	//Crossing numbers shift when a cluster gains or loses one
+	numberCrossings();
+}
@@ -0,0 +1,133 @@
+#ifndef HIERARCHICAL_INDEX_H
+#define HIERARCHICAL_INDEX_H
+
+#include <vector>
+
+#include "Maze.h"
+#include "Path.h"
+
+//Abstract graph over fixed size clusters of a maze, for answering many queries between any two cells, after HPA*
+//Each cluster keeps the costs between the crossings on its borders, so a query only searches the clusters at
+//its two ends and then the much smaller graph of crossings, refining the clusters along the route if a path is wanted
+//Narrow openings get a crossing on every cell, so routes are shortest on mazes with one cell wide corridors
+//Wide openings only get crossings at their ends, which can make routes through open areas a little longer
+class HierarchicalIndex
+{
+public:
+	HierarchicalIndex(const Maze &maze, int clusterSize = 32);
+
+	//Finds every crossing and the costs between them, needed after the maze is loaded or generated
+	void build();
+
+	//Call after changing a cell, only its cluster is redone, plus the neighbour across the border if it is on one
+	void update(int x, int y);
+
+	//Cost of a route following straight moves, the number of steps on unweighted mazes, -1 if there is none
+	//Never less than the cheapest route, and only certain to equal it on mazes of one cell wide corridors
+	int distance(int startX, int startY, int targetX, int targetY);
+	//Same as distance, also refining the route into a full path
+	int findPath(int startX, int startY, int targetX, int targetY, Path &path);
+
+	int getClusterSize() const { return _clusterSize; }
+	int getClusterCount() const { return (int)_clusters.size(); }
+	long long getCrossingCount() const { return _crossingCluster.size(); }
+
+	//Work done by the last query, the rest of the maze was never looked at
+	//Cells searched inside clusters, crossings taken off the abstract graph's queue and the edges tried from them
+	long long getTouchedCells() const { return _touched; }
+	long long getExpandedCrossings() const { return _expanded; }
+	long long getRelaxedEdges() const { return _relaxed; }
+
+private:
+	//Sides of a cluster, in the order their crossings are stored
+	enum Side
+	{
+		NORTH,
+		SOUTH,
+		EAST,
+		WEST
+	};
+
+	struct Cluster
+	{
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+
+		//Cell index of every crossing on the cluster's side of its borders, grouped by side
+		std::vector<int> cells;
+		//Where each side's crossings begin in cells, plus the end of the last side
+		int sideStart[5] = {};
+
+		//Cost from crossing i to crossing j without leaving the cluster at i * cells.size() + j, -1 if there is no route
+		std::vector<int> costs;
+	};
+
+	//Dijkstra within a single cluster, reused between searches
+	struct Search
+	{
+		std::vector<int> cost;
+		//Direction back towards the cell the search started from
+		std::vector<unsigned char> parent;
+		std::vector<std::pair<int, int>> heap;
+		long long touched = 0;
+	};
+
+	int clusterOf(int x, int y) const;
+	int localIndex(const Cluster &cluster, int cell) const;
+
+	//Positions along the border below or to the right of a cluster where both sides are open
+	void findCrossings(int cluster, bool south);
+	//Gathers the crossings on every side of the cluster and the costs between them
+	void buildCluster(int cluster, Search &search);
+
+	//Costs from the cell to every cell of the cluster, or from every cell to it when reversed
+	void searchCluster(int cluster, int cell, bool reverse, Search &search) const;
+
+	//Numbers every crossing of every cluster in cluster order, for the arrays queries use
+	void numberCrossings();
+	int crossingCell(int crossing) const;
+
+	//Crossing on the other side of a border, as a cluster and crossing index
+	void partner(int cluster, int crossing, int &otherCluster, int &otherCrossing) const;
+
+	//Appends the moves from one cell to another following a forward search's parents
+	void appendMoves(const Cluster &cluster, const Search &search, int from, int to, std::vector<Node::Direction> &moves) const;
+
+	int query(int startX, int startY, int targetX, int targetY, Path *path);
+
+	const Maze &_maze;
+	int _clusterSize;
+
+	int _clustersX = 0;
+	int _clustersY = 0;
+	unsigned long long _layoutVersion = 0;
+
+	//Clusters column by column, like the cells of the maze
+	std::vector<Cluster> _clusters;
+
+	//Crossings on the border below and to the right of each cluster, as offsets along that border
+	std::vector<std::vector<int>> _southCrossings;
+	std::vector<std::vector<int>> _eastCrossings;
+
+	//Number of each cluster's first crossing, plus the total, and the cluster of every crossing
+	std::vector<int> _firstCrossing;
+	std::vector<int> _crossingCluster;
+
+	Search _startSearch;
+	Search _targetSearch;
+	Search _refineSearch;
+	long long _touched = 0;
+	long long _expanded = 0;
+	long long _relaxed = 0;
+
+	//Abstract search state by crossing number, only valid where the stamp matches the current query's
+	std::vector<int> _visitCost;
+	std::vector<int> _visitPrevious;
+	std::vector<unsigned int> _visitStamp;
+	unsigned int _stamp = 0;
+	std::vector<std::pair<int, int>> _heap;
+};
+
+#endif
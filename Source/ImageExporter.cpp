@@ -0,0 +1,258 @@
+#include "ImageExporter.h"
+
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "Color.h"
+#include "WorkerPool.h"
+
+//Rows per band, small enough that a round of bands fits in memory for any maze width
+const int bandRows = 64;
+
+ImageExporter::ImageExporter(const Maze &maze) : _maze(maze)
+{
+	_threads = WorkerPool::shared().getThreadCount();
+}
+
+void ImageExporter::setScale(int scale)
+{
+	_scale = std::max(1, scale);
+}
+
+void ImageExporter::setThreads(int threads)
+{
+	_threads = std::max(1, threads);
+}
+
+void ImageExporter::setCompression(int level)
+{
+	_compression = std::min(9, std::max(0, level));
+}
+
+int ImageExporter::getWidth() const
+{
+	return (_maze.getX() + _scale - 1) / _scale;
+}
+
+int ImageExporter::getHeight() const
+{
+	return (_maze.getY() + _scale - 1) / _scale;
+}
+
+bool ImageExporter::save(const std::string &path) const
+{
+	std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return save(path, extension == ".ppm" ? Format::PPM : Format::PNG);
+}
+
+void ImageExporter::rasterise(int firstRow, int lastRow, std::vector<unsigned char> &out) const
+{
+	int width = getWidth();
+	int xCount = _maze.getX();
+	int yCount = _maze.getY();
+
+	//Byte colours for every type, looked up by the type's character
+	unsigned char palette[128][3] = {};
+	const Node::Type types[] = { Node::Type::SEARCHED, Node::Type::START, Node::Type::TARGET, Node::Type::TRACED, Node::Type::UNSEARCHED, Node::Type::WALL };
+	for (Node::Type type : types)
+	{
+		glm::vec3 color = getColor(type);
+		palette[type][0] = (unsigned char)(color.x * 255.0f + 0.5f);
+		palette[type][1] = (unsigned char)(color.y * 255.0f + 0.5f);
+		palette[type][2] = (unsigned char)(color.z * 255.0f + 0.5f);
+	}
+
+	out.resize((size_t)(lastRow - firstRow) * width * 3);
+	unsigned char *pixel = out.data();
+
+	TypeView view = _maze.getView();
+
+	if (_scale == 1)
+	{
+		for (int o = firstRow; o < lastRow; o++)
+		{
+			for (Node::Type type : view.row(o))
+			{
+				const unsigned char *color = palette[type & 127];
+				*pixel++ = color[0];
+				*pixel++ = color[1];
+				*pixel++ = color[2];
+			}
+		}
+
+		return;
+	}
+
+	//Average every block of cells, blocks on the far edges may be partial
+	std::vector<unsigned int> sums((size_t)width * 3);
+	for (int row = firstRow; row < lastRow; row++)
+	{
+		std::fill(sums.begin(), sums.end(), 0);
+
+		int yStart = row * _scale;
+		int yEnd = std::min(yCount, yStart + _scale);
+		for (int o = yStart; o < yEnd; o++)
+		{
+			TypeView::Line cells = view.row(o);
+			for (int i = 0; i < xCount; i++)
+			{
+				const unsigned char *color = palette[cells[i] & 127];
+				unsigned int *sum = &sums[(size_t)(i / _scale) * 3];
+				sum[0] += color[0];
+				sum[1] += color[1];
+				sum[2] += color[2];
+			}
+		}
+
+		for (int x = 0; x < width; x++)
+		{
+			int count = (std::min(xCount, (x + 1) * _scale) - x * _scale) * (yEnd - yStart);
+			*pixel++ = (unsigned char)(sums[x * 3] / count);
+			*pixel++ = (unsigned char)(sums[x * 3 + 1] / count);
+			*pixel++ = (unsigned char)(sums[x * 3 + 2] / count);
+		}
+	}
+}
+
+void ImageExporter::compressBand(int firstRow, int lastRow, bool last, std::vector<unsigned char> &out, unsigned long &adler) const
+{
+	std::vector<unsigned char> pixels;
+	rasterise(firstRow, lastRow, pixels);
+
+	//Every PNG row starts with its filter type, 0 leaves the row unfiltered
+	size_t rowBytes = (size_t)getWidth() * 3;
+	std::vector<unsigned char> raw((rowBytes + 1) * (lastRow - firstRow));
+	for (int row = 0; row < lastRow - firstRow; row++)
+	{
+		raw[row * (rowBytes + 1)] = 0;
+		std::copy(pixels.begin() + row * rowBytes, pixels.begin() + (row + 1) * rowBytes, raw.begin() + row * (rowBytes + 1) + 1);
+	}
+
+	adler = adler32(adler32(0, nullptr, 0), raw.data(), (uInt)raw.size());
+
+	//Raw deflate so that bands can be joined into one stream
+	//Sync flushing ends every band on a byte boundary and only the last band finishes the stream
+	z_stream stream = {};
+	deflateInit2(&stream, _compression, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+	out.resize(deflateBound(&stream, (uLong)raw.size()) + 16);
+	stream.next_in = raw.data();
+	stream.avail_in = (uInt)raw.size();
+	stream.next_out = out.data();
+	stream.avail_out = (uInt)out.size();
+
+	deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+}
+
+static void writeBigEndian(std::ofstream &output, unsigned long value)
+{
+	unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+	output.write((const char*)bytes, 4);
+}
+
+static void writeChunk(std::ofstream &output, const char *type, const unsigned char *data, size_t size)
+{
+	writeBigEndian(output, (unsigned long)size);
+
+	unsigned long crc = crc32(0, (const Bytef*)type, 4);
+	if (size > 0) crc = crc32(crc, data, (uInt)size);
+
+	output.write(type, 4);
+	if (size > 0) output.write((const char*)data, size);
+	writeBigEndian(output, crc);
+}
+
+bool ImageExporter::save(const std::string &path, Format format) const
+{
+	if (_maze.getX() == 0)
+	{
+		std::cout << "There is no maze to export." << std::endl;
+		return false;
+	}
+
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cout << "Could not open image at: " << path << std::endl;
+		return false;
+	}
+
+	int width = getWidth();
+	int height = getHeight();
+
+	if (format == Format::PPM)
+	{
+		output << "P6\n" << width << " " << height << "\n255\n";
+	}
+	else
+	{
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		output.write((const char*)signature, 8);
+
+		//Width, height, 8 bit depth, RGB, default compression, filtering and no interlacing
+		unsigned char header[13] = { (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+			(unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+			8, 2, 0, 0, 0 };
+		writeChunk(output, "IHDR", header, 13);
+
+		//zlib header for a 32K window, written by itself so that every band is pure deflate data
+		const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+		writeChunk(output, "IDAT", zlibHeader, 2);
+	}
+
+	int bandCount = (height + bandRows - 1) / bandRows;
+	unsigned long adler = adler32(0, nullptr, 0);
+
+	//Bands are handled a round at a time so memory stays bounded, then written out in order
+	std::vector<std::vector<unsigned char>> bands(_threads);
+	std::vector<unsigned long> bandAdlers(_threads);
+	for (int roundStart = 0; roundStart < bandCount; roundStart += _threads)
+	{
+		int roundCount = std::min(_threads, bandCount - roundStart);
+
+		WorkerPool::shared().forEach(roundCount, [&](int band)
+		{
+			int firstRow = (roundStart + band) * bandRows;
+			int lastRow = std::min(height, firstRow + bandRows);
+
+			if (format == Format::PPM) rasterise(firstRow, lastRow, bands[band]);
+			else compressBand(firstRow, lastRow, roundStart + band == bandCount - 1, bands[band], bandAdlers[band]);
+		});
+
+		for (int band = 0; band < roundCount; band++)
+		{
+			if (format == Format::PPM)
+			{
+				output.write((const char*)bands[band].data(), bands[band].size());
+				continue;
+			}
+
+			int firstRow = (roundStart + band) * bandRows;
+			int lastRow = std::min(height, firstRow + bandRows);
+			adler = adler32_combine(adler, bandAdlers[band], (z_off_t)(lastRow - firstRow) * ((z_off_t)width * 3 + 1));
+
+			writeChunk(output, "IDAT", bands[band].data(), bands[band].size());
+		}
+	}
+
+	if (format == Format::PNG)
+	{
+		unsigned char checksum[4] = { (unsigned char)(adler >> 24), (unsigned char)(adler >> 16), (unsigned char)(adler >> 8), (unsigned char)adler };
+		writeChunk(output, "IDAT", checksum, 4);
+		writeChunk(output, "IEND", nullptr, 0);
+	}
+
+	if (!output.good())
+	{
+		std::cout << "Failed while writing image to: " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
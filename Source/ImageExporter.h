@@ -0,0 +1,49 @@
+#ifndef IMAGE_EXPORTER_H
+#define IMAGE_EXPORTER_H
+
+#include <string>
+#include <vector>
+
+#include "Maze.h"
+
+//Renders a maze to an image file without needing a window
+//Rows of the image are split into bands that are rasterised and compressed on separate threads
+class ImageExporter
+{
+public:
+	enum Format
+	{
+		PPM,
+		PNG
+	};
+
+	ImageExporter(const Maze &maze);
+
+	//Each pixel of the output covers a scale x scale block of cells, averaging their colours
+	void setScale(int scale);
+	void setThreads(int threads);
+	//zlib level used for PNG output, speed matters more than size for huge mazes
+	void setCompression(int level);
+
+	int getWidth() const;
+	int getHeight() const;
+
+	//Picks the format from the file extension, defaulting to PNG
+	bool save(const std::string &path) const;
+	bool save(const std::string &path, Format format) const;
+
+private:
+	//Fills out with RGB pixels for image rows [firstRow, lastRow)
+	void rasterise(int firstRow, int lastRow, std::vector<unsigned char> &out) const;
+
+	//Compresses one band of rows as part of a single zlib stream
+	void compressBand(int firstRow, int lastRow, bool last, std::vector<unsigned char> &out, unsigned long &adler) const;
+
+	const Maze &_maze;
+
+	int _scale = 1;
+	int _threads = 1;
+	int _compression = 1;
+};
+
+#endif
@@ -6,6 +6,9 @@
 #include <chrono>
 #include <thread>
 
+#include <algorithm>
+#include <cmath>
+
 #define GLEW_STATIC
 #include <GL/glew.h>
 
@@ -15,23 +18,49 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Benchmark.h"
+#include "ImageExporter.h"
 #include "Maze.h"
+#include "MazeLOD.h"
+#include "SearchLog.h"
+#include "Server.h"
+#include "SolveCache.h"
+#include "WorkerPool.h"
 
 Maze maze;
+MazeLOD lod(maze);
 
 sf::Window *window;
 
-glm::mat4 aspectMat;
 glm::mat4 orthoMat;
 
 GLuint shaderProgram;
 GLuint orthoPos;
-GLuint aspectPos;
 //VAO
 GLuint vao;
 //VBOs
 GLuint vertexBuffer;
-GLuint colorBuffer;
+GLuint texCoordBuffer;
+//Colours of the visible blocks
+GLuint cellTexture;
+
+//Centre of the view in cells and the zoom in pixels per cell
+double viewX;
+double viewY;
+double viewZoom;
+bool viewChanged = true;
+
+//Blocks of the current level held in the texture
+int texLevel = 0;
+int texX = 0;
+int texY = 0;
+int texWidth = 0;
+int texHeight = 0;
+
+//Mouse drag panning
+bool dragging = false;
+int dragX = 0;
+int dragY = 0;
 
 GLuint initShaders(const std::string &vertexPath, const std::string &fragmentPath)
 {
@@ -146,28 +175,15 @@ GLuint initShaders(const std::string &vertexPath, const std::string &fragmentPat
 	return programID;
 }
 
-glm::vec3 getColor(Node::Type type)
+void resetView()
 {
-	switch (type)
-	{
-	case Node::Type::SEARCHED:
-		return glm::vec3(0.0, 0.4, 0.0);
-
-	case Node::Type::START:
-		return glm::vec3(0.0, 1.0, 0.25);
-
-	case Node::Type::TARGET:
-		return glm::vec3(1.0, 0.65, 0.0);
-
-	case Node::Type::TRACED:
-		return glm::vec3(0.1, 0.6, 1.0);
-
-	case Node::Type::UNSEARCHED:
-		return glm::vec3(1.0, 1.0, 1.0);
+	double xCount = maze.getX();
+	double yCount = maze.getY();
 
-	case Node::Type::WALL:
-		return glm::vec3(0.2, 0.2, 0.2);
-	}
+	viewX = xCount / 2.0;
+	viewY = yCount / 2.0;
+	viewZoom = std::min(window->getSize().x / xCount, window->getSize().y / yCount);
+	viewChanged = true;
 }
 
 void initGraphics()
@@ -187,186 +203,584 @@ void initGraphics()
 
 	shaderProgram = initShaders("Shaders\\vertex.gsl", "Shaders\\fragment.gsl");
 
-	int xCount = maze.getX();
-	int yCount = maze.getY();
+	orthoPos = glGetUniformLocation(shaderProgram, "ortho");
 
-	double windowAspect = (double)window->getSize().x / (double)window->getSize().y;
-	double targetAspect = (double)xCount / (double)yCount;
+	glClearColor(0.0, 0.0, 0.0, 0.0);
 
-	//Default aspect ratio (if window and maze have same ratio)
-	aspectMat = glm::ortho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &texCoordBuffer);
+
+	//Texels are one block each, so they must stay sharp when magnified
+	glGenTextures(1, &cellTexture);
+	glBindTexture(GL_TEXTURE_2D, cellTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	lod.build();
+	resetView();
+}
 
-	//Window is wider
-	//Touches vertical edges
-	if (windowAspect > targetAspect)
-	{
-		aspectMat = glm::ortho(-windowAspect / targetAspect, windowAspect / targetAspect, -1.0, 1.0, -1.0, 1.0);
-	}
-	//Window is taller
-	//Touches horizontal edges
-	else if (windowAspect < targetAspect)
-	{
-		aspectMat = glm::ortho(-1.0, 1.0, -targetAspect / windowAspect, targetAspect / windowAspect, -1.0, 1.0);
-	}
+//Fills the texture with only the blocks inside the view, one level of detail per frame
+void rebuildView()
+{
+	viewChanged = false;
 
-	aspectPos = glGetUniformLocation(shaderProgram, "aspect");
+	double halfWidth = window->getSize().x / 2.0 / viewZoom;
+	double halfHeight = window->getSize().y / 2.0 / viewZoom;
 
-	orthoMat = glm::ortho(0.0, (double)xCount, (double)yCount, 0.0, -1.0, 1.0);
-	orthoPos = glGetUniformLocation(shaderProgram, "ortho");
+	//Y is flipped so the maze reads top to bottom like the file
+	orthoMat = glm::ortho((float)(viewX - halfWidth), (float)(viewX + halfWidth), (float)(viewY + halfHeight), (float)(viewY - halfHeight), -1.0f, 1.0f);
 
-	glClearColor(0.0, 0.0, 0.0, 0.0);
+	//Pick the coarsest level where a block is no bigger than a pixel, so from 2 cells per pixel up
+	//each texel summarises its cells instead of sampling one of them
+	texLevel = 0;
+	double cellsPerPixel = 1.0 / viewZoom;
+	if (cellsPerPixel >= 2.0) texLevel = std::min(lod.getLevels() - 1, (int)std::floor(std::log2(cellsPerPixel)));
 
-	glGenBuffers(1, &vertexBuffer);
-	glGenBuffers(1, &colorBuffer);
+	int blockSize = 1 << texLevel;
+	texX = std::max(0, (int)std::floor((viewX - halfWidth) / blockSize));
+	texY = std::max(0, (int)std::floor((viewY - halfHeight) / blockSize));
+	texWidth = std::min(lod.getWidth(texLevel), (int)std::ceil((viewX + halfWidth) / blockSize)) - texX;
+	texHeight = std::min(lod.getHeight(texLevel), (int)std::ceil((viewY + halfHeight) / blockSize)) - texY;
 
-	std::vector<glm::vec2> vertexData;
-	//Fill vertex buffer because it won't change
-	for (int i = 0; i < xCount; i++)
-	{
-		for (int o = 0; o < yCount; o++)
-		{
-			vertexData.push_back(glm::vec2(i, o));
-			vertexData.push_back(glm::vec2(i + 1, o));
-			vertexData.push_back(glm::vec2(i, o + 1));
+	if (texWidth <= 0 || texHeight <= 0) return;
 
-			vertexData.push_back(glm::vec2(i + 1, o));
-			vertexData.push_back(glm::vec2(i, o + 1));
-			vertexData.push_back(glm::vec2(i + 1, o + 1));
-		}
-	}
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(vertexData[0]), &vertexData[0], GL_STATIC_DRAW);
-	std::vector<glm::vec3> colorData;
-	//Fill buffers
-	for (int i = 0; i < maze.getX(); i++)
+	//Rows of the texture are shared out between threads
+	std::vector<unsigned char> texels((size_t)texWidth * texHeight * 3);
+	WorkerPool::shared().forEach(texHeight, [&](int o)
 	{
-		for (int o = 0; o < maze.getY(); o++)
+		unsigned char *texel = &texels[(size_t)o * texWidth * 3];
+		for (int i = 0; i < texWidth; i++)
 		{
-			glm::vec3 color = getColor(maze.getType(i, o));
-
-			colorData.push_back(color);
-			colorData.push_back(color);
-			colorData.push_back(color);
-			colorData.push_back(color);
-			colorData.push_back(color);
-			colorData.push_back(color);
+			glm::vec3 color = lod.getColor(texLevel, texX + i, texY + o);
+			*texel++ = (unsigned char)(color.x * 255.0f);
+			*texel++ = (unsigned char)(color.y * 255.0f);
+			*texel++ = (unsigned char)(color.z * 255.0f);
 		}
-	}
+	});
+
+	glBindTexture(GL_TEXTURE_2D, cellTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texWidth, texHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, &texels[0]);
+
+	//Blocks on the far edges can hang over the maze, so the quad and its texture coordinates are clipped
+	float left = texX * blockSize;
+	float top = texY * blockSize;
+	float right = std::min(maze.getX(), (texX + texWidth) * blockSize);
+	float bottom = std::min(maze.getY(), (texY + texHeight) * blockSize);
+	float u = (right - left) / (texWidth * blockSize);
+	float v = (bottom - top) / (texHeight * blockSize);
+
+	std::vector<glm::vec2> vertexData = {
+		glm::vec2(left, top), glm::vec2(right, top), glm::vec2(left, bottom),
+		glm::vec2(right, top), glm::vec2(left, bottom), glm::vec2(right, bottom)
+	};
+	std::vector<glm::vec2> texCoordData = {
+		glm::vec2(0, 0), glm::vec2(u, 0), glm::vec2(0, v),
+		glm::vec2(u, 0), glm::vec2(0, v), glm::vec2(u, v)
+	};
 
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
-	glBufferData(GL_ARRAY_BUFFER, colorData.size() * sizeof(colorData[0]), &colorData[0], GL_DYNAMIC_DRAW);
-
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	glUseProgram(shaderProgram);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(vertexData[0]), &vertexData[0], GL_DYNAMIC_DRAW);
 
-	glUniformMatrix4fv(aspectPos, 1, GL_FALSE, &aspectMat[0][0]);
-	glUniformMatrix4fv(orthoPos, 1, GL_FALSE, &orthoMat[0][0]);
+	glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+	glBufferData(GL_ARRAY_BUFFER, texCoordData.size() * sizeof(texCoordData[0]), &texCoordData[0], GL_DYNAMIC_DRAW);
+}
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+void updateData(glm::vec2 position)
+{
+	int x = position.x;
+	int y = position.y;
 
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	lod.refresh(x, y);
 
-	glDrawArrays(GL_TRIANGLES, 0, maze.getX() * maze.getY() * 6);
+	//Only the block holding the cell needs to change, and only if it is on screen
+	int blockX = (x >> texLevel) - texX;
+	int blockY = (y >> texLevel) - texY;
+	if (viewChanged || blockX < 0 || blockY < 0 || blockX >= texWidth || blockY >= texHeight) return;
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+	glm::vec3 color = lod.getColor(texLevel, texX + blockX, texY + blockY);
+	unsigned char texel[3] = { (unsigned char)(color.x * 255.0f), (unsigned char)(color.y * 255.0f), (unsigned char)(color.z * 255.0f) };
 
-	window->display();
+	glBindTexture(GL_TEXTURE_2D, cellTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, blockX, blockY, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, texel);
 }
 
-void updateData(glm::vec2 position)
+void updateCells(const int *cells, size_t count)
 {
-	int x = position.x;
-	int y = position.y;
+	if (count == 0) return;
+
+	//Every changed block on screen is uploaded in one rectangle instead of a texel at a time
+	int left = texWidth;
+	int top = texHeight;
+	int right = -1;
+	int bottom = -1;
+	for (size_t i = 0; i < count; i++)
+	{
+		int x = cells[i] / maze.getY();
+		int y = cells[i] % maze.getY();
 
-	std::vector<glm::vec3> colorData;
-	glm::vec3 color = getColor(maze.getType(x, y));
+		lod.refresh(x, y);
 
-	colorData.push_back(color);
-	colorData.push_back(color);
-	colorData.push_back(color);
-	colorData.push_back(color);
-	colorData.push_back(color);
-	colorData.push_back(color);
+		int blockX = (x >> texLevel) - texX;
+		int blockY = (y >> texLevel) - texY;
+		if (blockX < 0 || blockY < 0 || blockX >= texWidth || blockY >= texHeight) continue;
 
-	int offset = 6 * (x * maze.getY() + y);
-	offset *= sizeof(colorData[0]);
+		left = std::min(left, blockX);
+		top = std::min(top, blockY);
+		right = std::max(right, blockX);
+		bottom = std::max(bottom, blockY);
+	}
+
+	if (viewChanged || right < left) return;
 
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
-	glBufferSubData(GL_ARRAY_BUFFER, offset, colorData.size() * sizeof(colorData[0]), &colorData[0]);
+	int width = right - left + 1;
+	int height = bottom - top + 1;
+	std::vector<unsigned char> texels((size_t)width * height * 3);
+	unsigned char *texel = &texels[0];
+	for (int o = top; o <= bottom; o++)
+	{
+		for (int i = left; i <= right; i++)
+		{
+			glm::vec3 color = lod.getColor(texLevel, texX + i, texY + o);
+			*texel++ = (unsigned char)(color.x * 255.0f);
+			*texel++ = (unsigned char)(color.y * 255.0f);
+			*texel++ = (unsigned char)(color.z * 255.0f);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, cellTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, left, top, width, height, GL_RGB, GL_UNSIGNED_BYTE, &texels[0]);
 }
 
 void draw()
 {
+	if (viewChanged) rebuildView();
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	glUseProgram(shaderProgram);
+	if (texWidth > 0 && texHeight > 0)
+	{
+		glUseProgram(shaderProgram);
 
-	glUniformMatrix4fv(aspectPos, 1, GL_FALSE, &aspectMat[0][0]);
-	glUniformMatrix4fv(orthoPos, 1, GL_FALSE, &orthoMat[0][0]);
+		glUniformMatrix4fv(orthoPos, 1, GL_FALSE, &orthoMat[0][0]);
 
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, cellTexture);
 
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-	glDrawArrays(GL_TRIANGLES, 0, maze.getX() * maze.getY() * 6);
+		glEnableVertexAttribArray(1);
+		glBindBuffer(GL_ARRAY_BUFFER, texCoordBuffer);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
+	}
 
 	window->display();
 }
 
+//Zooms by factor while keeping the cell under the given pixel still
+void zoomView(double factor, int pixelX, int pixelY)
+{
+	double offsetX = pixelX - window->getSize().x / 2.0;
+	double offsetY = pixelY - window->getSize().y / 2.0;
+
+	viewX += offsetX / viewZoom - offsetX / (viewZoom * factor);
+	viewY += offsetY / viewZoom - offsetY / (viewZoom * factor);
+	viewZoom *= factor;
+	viewChanged = true;
+}
+
+//Returns false once the window has been closed
+bool handleEvents()
+{
+	sf::Event event;
+	while (window->pollEvent(event))
+	{
+		switch (event.type)
+		{
+		case sf::Event::Closed:
+			window->close();
+			return false;
+
+		case sf::Event::Resized:
+			glViewport(0, 0, event.size.width, event.size.height);
+			viewChanged = true;
+			break;
+
+		case sf::Event::MouseWheelScrolled:
+			zoomView(event.mouseWheelScroll.delta > 0 ? 1.25 : 0.8, event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+			break;
+
+		case sf::Event::MouseButtonPressed:
+			if (event.mouseButton.button == sf::Mouse::Left)
+			{
+				dragging = true;
+				dragX = event.mouseButton.x;
+				dragY = event.mouseButton.y;
+			}
+			break;
+
+		case sf::Event::MouseButtonReleased:
+			if (event.mouseButton.button == sf::Mouse::Left) dragging = false;
+			break;
+
+		case sf::Event::MouseMoved:
+			if (dragging)
+			{
+				viewX -= (event.mouseMove.x - dragX) / viewZoom;
+				viewY -= (event.mouseMove.y - dragY) / viewZoom;
+				dragX = event.mouseMove.x;
+				dragY = event.mouseMove.y;
+				viewChanged = true;
+			}
+			break;
+
+		case sf::Event::KeyPressed:
+		{
+			//Arrow keys pan by a tenth of the screen
+			double panX = window->getSize().x / 10.0 / viewZoom;
+			double panY = window->getSize().y / 10.0 / viewZoom;
+
+			switch (event.key.code)
+			{
+			case sf::Keyboard::Left:
+				viewX -= panX;
+				break;
+
+			case sf::Keyboard::Right:
+				viewX += panX;
+				break;
+
+			case sf::Keyboard::Up:
+				viewY -= panY;
+				break;
+
+			case sf::Keyboard::Down:
+				viewY += panY;
+				break;
+
+			case sf::Keyboard::Add:
+			case sf::Keyboard::Equal:
+				zoomView(1.25, window->getSize().x / 2, window->getSize().y / 2);
+				break;
+
+			case sf::Keyboard::Subtract:
+			case sf::Keyboard::Hyphen:
+				zoomView(0.8, window->getSize().x / 2, window->getSize().y / 2);
+				break;
+
+			case sf::Keyboard::Home:
+				resetView();
+				break;
+
+			default:
+				break;
+			}
+
+			viewChanged = true;
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
 void drawProcess()
 {
 	int sleepMS = 15;
 	if (maze.getX() * maze.getY() > 625) sleepMS = 5;
 	if (maze.getX() * maze.getY() > 2500) sleepMS = 2;
+	//Huge mazes would take days at one cell per frame, so they are searched a frame's worth at a time
+	if (maze.getX() * maze.getY() > 1000000) sleepMS = 0;
 
-	glm::vec2 updatePos;
-	while (maze.stepProcess(updatePos))
+	//Slowed down searches take a single step per batch so the search can be watched cell by cell
+	std::vector<int> changed(sleepMS > 0 ? 4 : 1 << 16);
+
+	bool done = false;
+	while (!done)
 	{
+		size_t count = maze.stepProcess(&changed[0], changed.size(), done, sleepMS > 0 ? 0.0 : 16.0);
+
 		//Looks cool for visualizations, but is shortend for large mazes
-		std::this_thread::sleep_for(std::chrono::milliseconds(sleepMS));
+		if (sleepMS > 0) std::this_thread::sleep_for(std::chrono::milliseconds(sleepMS));
 
-		updateData(updatePos);
+		updateCells(&changed[0], count);
+
+		if (!handleEvents()) exit(0);
 		draw();
 	}
 
-	std::cout << "Solution found in " << maze.getSteps() << " steps." << std::endl;
+	Node start = maze.getSolvedStart();
+	Node target = maze.getSolvedTarget();
+
+	if (target.x == -1) std::cout << "No solution found." << std::endl;
+	else std::cout << "Solution found in " << maze.getSteps() << " steps from (" << start.x << ", " << start.y << ") to (" << target.x << ", " << target.y << ")." << std::endl;
 }
 
 void drawTrace()
 {
 	int traceMS = 5000;
-	int steps = maze.getSteps();
+	int steps = std::max(1, maze.getSteps());
+
+	//Long paths trace several cells per frame so the whole trace still takes about the same time
+	int perFrame = std::max(1, steps / (traceMS / 16));
+	int sleepMS = traceMS * perFrame / steps;
+	std::vector<int> changed(perFrame);
+
+	bool done = false;
+	while (!done)
+	{
+		size_t count = maze.stepTrace(&changed[0], perFrame, done);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(sleepMS));
+
+		updateCells(&changed[0], count);
+
+		if (!handleEvents()) exit(0);
+		draw();
+	}
+}
+
+//Keeps the finished maze on screen for panning and zooming until the window closes
+void view()
+{
+	while (handleEvents())
+	{
+		if (viewChanged) draw();
+		else std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+}
+
+//Shows a recorded solve, paced to take about ten seconds whatever the solver speed was
+void drawReplay(SearchLog &log)
+{
+	long long perFrame = std::max(1LL, log.getEventCount() / 600);
 
 	glm::vec2 updatePos;
-	while (maze.stepTrace(updatePos))
+	bool replaying = true;
+	while (replaying)
 	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(traceMS / steps));
+		auto frameStart = std::chrono::steady_clock::now();
 
-		updateData(updatePos);
+		for (long long i = 0; i < perFrame && (replaying = log.step(maze, updatePos)); i++)
+		{
+			updateData(updatePos);
+		}
 
+		if (!handleEvents()) exit(0);
 		draw();
+
+		std::this_thread::sleep_until(frameStart + std::chrono::milliseconds(16));
 	}
+
+	std::cout << "Replayed " << log.getSearchedCount() << " searched and " << log.getTracedCount() << " traced cells." << std::endl;
 }
 
-int main()
+void exportImage(const std::string &path, int scale, const std::string &cachePath)
 {
+	if (!cachePath.empty())
+	{
+		SolveCache cache(cachePath);
+		cache.solve(maze);
+	}
+	else
+	{
+		maze.process();
+		maze.trace();
+	}
+
+	ImageExporter exporter(maze);
+	exporter.setScale(scale);
+
+	if (exporter.save(path)) std::cout << "Exported " << exporter.getWidth() << "x" << exporter.getHeight() << " image to " << path << std::endl;
+}
+
+//Inserts a frame number before the extension, out.png becomes out_0001.png
+std::string framePath(const std::string &path, int frame)
+{
+	std::string number = std::to_string(frame);
+	number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) return path + "_" + number;
+
+	return path.substr(0, dot) + "_" + number + path.substr(dot);
+}
+
+//Writes evenly spaced frames of a recorded solve, the last frame always shows the finished solve
+void exportReplay(SearchLog &log, const std::string &path, int scale, int frames)
+{
+	ImageExporter exporter(maze);
+	exporter.setScale(scale);
+
+	long long perFrame = std::max(1LL, log.getEventCount() / frames);
+	for (int frame = 1; frame <= frames; frame++)
+	{
+		for (long long i = 0; (i < perFrame || frame == frames) && log.step(maze); i++);
+
+		std::string outPath = frames > 1 ? framePath(path, frame) : path;
+		if (!exporter.save(outPath)) return;
+	}
+
+	std::cout << "Exported " << frames << " frames of " << exporter.getWidth() << "x" << exporter.getHeight() << " to " << path << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string loadPath;
+	int xSize = 750;
+	int ySize = 500;
+
+	std::string exportPath;
+	int exportScale = 1;
+	int exportFrames = 1;
+
+	std::string recordPath;
+	std::string replayPath;
+	std::string savePath;
+	int benchmarkRuns = 0;
+	std::string cachePath;
+	bool analyse = false;
+	bool rejectUnreachable = false;
+	std::string servePath;
+	int serveWorkers = 0;
+	long long serveCells = 100000000;
+
+	//Options:
+	//  --load <path>            solve a maze from a file instead of generating one
+	//  --generate <x> <y>       size of the generated maze
+	//  --export <path> [scale]  solve without a window and save a PNG or PPM image
+	//  --frames <count>         export a replay as this many numbered images
+	//  --record <path>          save the order cells were searched and traced
+	//  --replay <path>          show or export a recorded solve of the loaded maze instead of solving, needs --load
+	//  --save <path>            save the solved maze as text
+	//  --benchmark [runs]       time the solver kernels on the maze and exit
+	//  --cache <directory>      reuse solutions of mazes exported before
+	//  --analyse                report how the maze's open cells are connected and exit
+	//  --reject-unreachable     label the open cells before solving, so a maze with no route is refused without a search
+	//  --serve <socket> [workers] [max cells]  answer requests about resident mazes over a Unix domain socket until shut down
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "--load" && i + 1 < argc) loadPath = argv[++i];
+		else if (arg == "--generate" && i + 2 < argc)
+		{
+			xSize = std::stoi(argv[++i]);
+			ySize = std::stoi(argv[++i]);
+		}
+		else if (arg == "--export" && i + 1 < argc)
+		{
+			exportPath = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-') exportScale = std::stoi(argv[++i]);
+		}
+		else if (arg == "--frames" && i + 1 < argc) exportFrames = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+		else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+		else if (arg == "--save" && i + 1 < argc) savePath = argv[++i];
+		else if (arg == "--cache" && i + 1 < argc) cachePath = argv[++i];
+		else if (arg == "--analyse") analyse = true;
+		else if (arg == "--reject-unreachable") rejectUnreachable = true;
+		else if (arg == "--serve" && i + 1 < argc)
+		{
+			servePath = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-') serveWorkers = std::max(1, std::stoi(argv[++i]));
+			if (i + 1 < argc && argv[i + 1][0] != '-') serveCells = std::stoll(argv[++i]);
+		}
+		else if (arg == "--benchmark")
+		{
+			benchmarkRuns = 5;
+			if (i + 1 < argc && argv[i + 1][0] != '-') benchmarkRuns = std::max(1, std::stoi(argv[++i]));
+		}
+		else
+		{
+			std::cout << "Unknown option: " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	//A generated maze is different every time, so a replay needs the maze it was recorded on
+	if (!replayPath.empty() && loadPath.empty())
+	{
+		std::cout << "--replay needs --load with the maze that was recorded." << std::endl;
+		return 1;
+	}
+
+	//Mazes are loaded by the server's clients, so none is needed up front
+	if (!servePath.empty())
+	{
+		Server server(servePath, serveWorkers, serveCells);
+		return server.run() ? 0 : 1;
+	}
+
 	maze = Maze();
 	//maze.load("mazes\\maze3.txt");
-	maze.generate(750, 500);
+	if (!loadPath.empty())
+	{
+		if (!maze.load(loadPath)) return 1;
+	}
+	else maze.generate(xSize, ySize);
+
+	if (maze.getX() == 0) return 1;
+
+	maze.setRejectUnreachable(rejectUnreachable);
+
+	if (analyse)
+	{
+		const Connectivity &connectivity = maze.getConnectivity();
+		const std::vector<long long> &sizes = connectivity.getSizes();
+
+		std::cout << connectivity.getCellCount() << " open cells in " << connectivity.getComponentCount() << " components, the largest has " << (sizes.empty() ? 0 : *std::max_element(sizes.begin(), sizes.end())) << " cells." << std::endl;
+		std::cout << (connectivity.isPerfect() ? "The maze is perfect." : connectivity.hasCycles() ? "The maze has cycles." : "The maze has no cycles.") << std::endl;
+		std::cout << (connectivity.startsReachTargets() ? "A start and a target are connected." : "No start is connected to a target.") << std::endl;
+		return 0;
+	}
+
+	if (benchmarkRuns > 0)
+	{
+		runBenchmark(maze, benchmarkRuns);
+		return 0;
+	}
+
+	SearchLog log;
+	if (!replayPath.empty())
+	{
+		if (!log.load(replayPath)) return 1;
+
+		if (!exportPath.empty()) exportReplay(log, exportPath, exportScale, exportFrames);
+		else
+		{
+			initGraphics();
+			drawReplay(log);
+			view();
+		}
+
+		return 0;
+	}
+
+	if (!recordPath.empty()) maze.setLog(&log);
+
+	//Exporting is headless, so no window is opened
+	if (!exportPath.empty())
+	{
+		exportImage(exportPath, exportScale, cachePath);
+		if (!recordPath.empty()) log.save(recordPath);
+		if (!savePath.empty()) maze.save(savePath);
+		return 0;
+	}
 
 	initGraphics();
 	drawProcess();
@@ -374,6 +788,11 @@ int main()
 
 	std::cout << "Tracing complete." << std::endl;
 
+	if (!recordPath.empty()) log.save(recordPath);
+	if (!savePath.empty()) maze.save(savePath);
+
+	view();
+
 	//drawProcess();
 	//drawTrace();
 
@@ -404,7 +823,5 @@ int main()
 	}
 	*/
 
-	std::cin.get();
-
 	return 0;
 }
\ No newline at end of file
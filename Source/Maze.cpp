@@ -1,5 +1,14 @@
 #include "Maze.h"
 
+#include "Path.h"
+#include "RowClassifier.h"
+#include "SearchLog.h"
+#include "SolverKernels.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <random>
 #include <time.h>
 
@@ -12,118 +21,231 @@ Maze::Maze(const std::string path)
 	load(path);
 }
 
-Node Maze::getStart() const
+void Maze::find(Node::Type type, std::vector<Node> &output) const
 {
-	Node tmp;
+	output.clear();
 
-	//Loop through every node to ensure that there is only one
-	//Return an invalid node if multiple are found to trigger error
-	for (int i = 0; i < _maze.size(); i++)
+	for (int i = 0; i < _xSize; i++)
 	{
-		for (int o = 0; o < _maze[i].size(); o++)
+		for (int o = 0; o < _ySize; o++)
 		{
-			if (_maze[i][o].type == Node::Type::START)
-			{
-				if(tmp.steps == -1) tmp = _maze[i][o];
-				else return Node();
-			}
+			if (node(i, o).type == type) output.push_back(node(i, o));
 		}
 	}
+}
+
+std::vector<Node> Maze::getStarts() const
+{
+	std::vector<Node> starts;
+	find(Node::Type::START, starts);
+
+	return starts;
+}
 
-	return tmp;
+std::vector<Node> Maze::getTargets() const
+{
+	std::vector<Node> targets;
+	find(Node::Type::TARGET, targets);
+
+	return targets;
+}
+
+Node Maze::getStart() const
+{
+	//Return an invalid node if there isn't exactly one
+	std::vector<Node> starts = getStarts();
+	if (starts.size() != 1) return Node();
+
+	return starts[0];
 }
 
 Node Maze::getTarget() const
 {
-	Node tmp;
+	//Return an invalid node if there isn't exactly one
+	std::vector<Node> targets = getTargets();
+	if (targets.size() != 1) return Node();
+
+	return targets[0];
+}
 
-	//Loop through every node to ensure that there is only one
-	//Return an invalid node if multiple are found to trigger error
-	for (int i = 0; i < _maze.size(); i++)
+Node Maze::getSolvedStart() const
+{
+	if (_reachedX == -1) return Node();
+
+	//Follow the parents back from the target to whichever start the path came from
+	Node current = node(_reachedX, _reachedY);
+	while (current.type != Node::Type::START)
 	{
-		for (int o = 0; o < _maze[i].size(); o++)
-		{
-			if (_maze[i][o].type == Node::Type::TARGET)
-			{
-				if (tmp.x == -1) tmp = _maze[i][o];
-				else return Node();
-			}
-		}
+		if (current.parent == Node::Direction::NONE) return Node();
+
+		int x = current.x;
+		int y = current.y;
+		follow(x, y, current.parent);
+		current = node(x, y);
 	}
 
-	return tmp;
+	return current;
 }
 
-void Maze::load(const std::string &path)
+Node Maze::getSolvedTarget() const
+{
+	if (_reachedX == -1) return Node();
+
+	return node(_reachedX, _reachedY);
+}
+
+int Maze::getSteps() const
+{
+	return _reachedX == -1 ? -1 : node(_reachedX, _reachedY).steps;
+}
+
+bool Maze::load(const std::string &path)
 {
 	_maze.clear();
+	_xSize = 0;
+	_ySize = 0;
+	_version++;
+	_layoutVersion++;
+	_connectivity.clear();
+	_searched = false;
+	_reachedX = -1;
+	_reachedY = -1;
+	_maxWeight = 1;
 
 	std::ifstream input;
-	input.open(path);
+	input.open(path, std::ios::binary);
 	if (!input.is_open())
 	{
 		std::cout << "Could not open maze at: " << path << std::endl;
-		return;
+		return false;
 	}
 
-	int rowCount = 0;
-	std::string row;
+	//The whole file is read at once, and the rows are found in place rather than copied out one by one
+	input.seekg(0, std::ios::end);
+	std::string text((size_t)input.tellg(), '\0');
+	input.seekg(0, std::ios::beg);
+	input.read(&text[0], text.size());
 
 	//Because files are read by row and not by column, the maze must have its x and y swapped
-	//First it is loaded into a vector of strings, and then it is flipped after it is determined to be rectangular
-	std::vector<std::string> tmpVector;
-	while (std::getline(input, row))
+	//First the start of every row is found, and then it is flipped after it is determined to be rectangular
+	std::vector<const char *> rows;
+	std::vector<int> rowLengths;
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		const char *line = text.data() + lineStart;
+		const char *lineEnd = (const char *)std::memchr(line, '\n', text.size() - lineStart);
+		size_t length = lineEnd != nullptr ? lineEnd - line : text.size() - lineStart;
+		lineStart += length + 1;
+
+		//Lines written on Windows end in \r\n
+		if (length > 0 && line[length - 1] == '\r') length--;
+
+		rows.push_back(line);
+		rowLengths.push_back((int)length);
+	}
+
+	if (rows.empty() || rowLengths[0] == 0)
 	{
-		tmpVector.push_back(row);
+		std::cout << "Maze loaded from " << path << " is empty. Please check the maze and try again." << std::endl;
+		return false;
 	}
 
 	//Ensure that the maze is rectangular
 	//This is done before other error checking to prevent crashes when rotating
-	int xSize = tmpVector[0].size();
-	for (int i = 1; i < tmpVector.size(); i++)
+	int xSize = rowLengths[0];
+	int ySize = (int)rows.size();
+	for (int o = 1; o < ySize; o++)
 	{
-		if (xSize != tmpVector[i].size())
+		if (xSize != rowLengths[o])
 		{
 			std::cout << "Maze loaded from " << path << " is not a rectangle. Please check the maze and try again." << std::endl;
-			return;
+			return false;
 		}
 	}
 
-	_maze.resize(tmpVector[0].size());
-	for (int i = 0; i < tmpVector[0].size(); i++)
+	//Every character is checked before any node is made, so the fill below can trust them
+	long long starts = 0;
+	long long targets = 0;
+	int maxWeight = 1;
+	for (int o = 0; o < ySize; o++)
 	{
-		_maze[i].resize(tmpVector.size());
-	}
-
-	//Convert the maze into nodes
-	for (int i = 0; i < _maze.size(); i++)
-	{
-		for (int o = 0; o < _maze[0].size(); o++)
+		RowClasses classes = classifyRow(rows[o], xSize);
+		if (classes.invalid != -1)
 		{
-			//Swap i and o for tmpVector to flip the maze
-			_maze[i][o] = Node(Node::Type(tmpVector[o][i]), i, o);
+			std::cout << "Maze loaded from " << path << " has an invalid character '" << rows[o][classes.invalid] << "' at line " << o + 1 << ", column " << classes.invalid + 1 << ". Please check the maze and try again." << std::endl;
+			return false;
 		}
+
+		starts += classes.starts;
+		targets += classes.targets;
+		maxWeight = std::max(maxWeight, classes.maxWeight);
 	}
 
-	Node test = getStart();
-	if (test.x == -1)
+	//Any number of starts and targets are allowed, the solve finds the nearest pair
+	if (starts == 0)
 	{
-		std::cout << "Maze loaded from " << path << " has no marked start or has multiple starts. Please check the maze and try again." << std::endl;
-		return;
+		std::cout << "Maze loaded from " << path << " has no marked start. Please check the maze and try again." << std::endl;
+		return false;
 	}
 
-	test = getTarget();
-	if (test.x == -1)
+	if (targets == 0)
 	{
-		std::cout << "Maze loaded from " << path << "has no marked end or multiple ends. Please check the maze and try again." << std::endl;
-		return;
+		std::cout << "Maze loaded from " << path << " has no marked end. Please check the maze and try again." << std::endl;
+		return false;
 	}
 
+	_xSize = xSize;
+	_ySize = ySize;
+	_maxWeight = maxWeight;
+	_maze.resize((size_t)_xSize * _ySize);
+
+	//Convert the maze into nodes, a block of columns on each core
+	//Each block goes down a tile of rows at a time so the rows it reads across stay in cache
+	const int blockColumns = 64;
+	const int tileRows = 256;
+	int blockCount = (_xSize + blockColumns - 1) / blockColumns;
+
+	//Files written after a solve keep its searched and traced marks, which reset then has to clear
+	std::vector<unsigned char> marked(blockCount);
+
+	WorkerPool::shared().forEach(blockCount, [&](int block)
+	{
+		int firstColumn = block * blockColumns;
+		int lastColumn = std::min(_xSize, firstColumn + blockColumns);
+
+		for (int firstRow = 0; firstRow < _ySize; firstRow += tileRows)
+		{
+			int lastRow = std::min(_ySize, firstRow + tileRows);
+
+			for (int i = firstColumn; i < lastColumn; i++)
+			{
+				Node *column = &node(i, 0);
+				for (int o = firstRow; o < lastRow; o++)
+				{
+					//Swap i and o for the rows to flip the maze
+					char cell = rows[o][i];
+					Node &current = column[o];
+					current.x = i;
+					current.y = o;
+
+					//Digits other than the start are open cells that cost more to cross
+					if (cell >= '1' && cell <= '9') current.weight = cell - '0';
+					else current.type = Node::Type(cell);
+
+					if (cell == Node::Type::SEARCHED || cell == Node::Type::TRACED) marked[block] = 1;
+				}
+			}
+		}
+	});
+
+	_searched = std::find(marked.begin(), marked.end(), 1) != marked.end();
+
 	//Check if there is a top border
 	bool border = true;
-	for (int i = 0; i < _maze.size(); i++)
+	for (int i = 0; i < _xSize; i++)
 	{
-		if (_maze[i][0].type != Node::Type::WALL)
+		if (node(i, 0).type != Node::Type::WALL)
 		{
 			border = false;
 			break;
@@ -131,177 +253,457 @@ void Maze::load(const std::string &path)
 	}
 
 	//TODO: Add borders if they don't exist
+
+	return true;
 }
 
 bool Maze::stepProcess()
 {
-	//Call the other function so that the static vector is consistent
-	return stepProcess(glm::vec2());
+	glm::vec2 updatePos;
+	return stepProcess(updatePos);
 }
 
 bool Maze::stepTrace()
 {
-	//Call the other function so that the static Node is consistent
-	return stepTrace(glm::vec2());
+	glm::vec2 updatePos;
+	return stepTrace(updatePos);
 }
 
-bool Maze::stepProcess(glm::vec2 &updatePos)
+size_t Maze::stepProcess(int *changed, size_t capacity, bool &done, double budgetMS)
+{
+	return stepBatch(changed, capacity, done, budgetMS, false);
+}
+
+size_t Maze::stepTrace(int *changed, size_t capacity, bool &done, double budgetMS)
 {
-	static std::vector<Node> unsearched;
-	if (unsearched.size() == 0)
+	return stepBatch(changed, capacity, done, budgetMS, true);
+}
+
+size_t Maze::stepBatch(int *changed, size_t capacity, bool &done, double budgetMS, bool tracing)
+{
+	//A search step changes at most one cell per neighbour, a trace step only the cell it is on
+	const size_t stepChanges = tracing ? 1 : 4;
+
+	_batch = changed;
+	_batchCount = 0;
+	done = false;
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budgetMS);
+
+	glm::vec2 updatePos;
+	for (long long steps = 1; _batchCount + stepChanges <= capacity; steps++)
 	{
-		//Make sure start hasn't already been used
-		Node tmp = getStart();
-		if (tmp.steps == -1)
+		if (!(tracing ? stepTrace(updatePos) : stepProcess(updatePos)))
 		{
-			_maze[tmp.x][tmp.y].steps = 0;
-			unsearched.push_back(_maze[tmp.x][tmp.y]);
+			done = true;
+			break;
 		}
-		else return false;
+
+		//Reading the clock costs more than a step, so it is only checked every so often
+		if (budgetMS > 0.0 && steps % 64 == 0 && std::chrono::steady_clock::now() >= deadline) break;
+	}
+
+	_batch = nullptr;
+	return _batchCount;
+}
+
+void Maze::markSearched(int x, int y)
+{
+	if (_log) _log->addSearched(x, y);
+	if (_batch) _batch[_batchCount++] = x * _ySize + y;
+}
+
+void Maze::markTraced(int x, int y)
+{
+	if (_log) _log->addTraced(x, y);
+	if (_batch) _batch[_batchCount++] = x * _ySize + y;
+}
+
+bool Maze::seedStarts()
+{
+	SolverWorkspace &ws = getWorkspace();
+
+	ws.starts.clear();
+	for (size_t i = 0; i < _maze.size(); i++)
+	{
+		if (_maze[i].type == Node::Type::START) ws.starts.push_back(i);
 	}
 
-	Node currentNode = unsearched[0];
-	unsearched.erase(unsearched.begin());
+	//Make sure start hasn't already been used
+	if (ws.starts.size() == 0 || _maze[ws.starts[0]].steps != -1) return false;
+
+	for (int start : ws.starts)
+	{
+		_maze[start].steps = 0;
+	}
+
+	_searched = true;
+	ws.owner = this;
+	_reachedX = -1;
+	_reachedY = -1;
+
+	if (_log) _log->begin(*this);
+
+	return true;
+}
+
+bool Maze::stepProcess(glm::vec2 &updatePos)
+{
+	bool stepped = _maxWeight > 1 ? stepWeighted(updatePos) : stepBreadthFirst(updatePos);
+
+	//The buffers are checked once a search is over rather than after every step
+	if (!stepped) getWorkspace().track();
+
+	return stepped;
+}
+
+bool Maze::stepBreadthFirst(glm::vec2 &updatePos)
+{
+	SolverWorkspace &ws = getWorkspace();
+	if (ws.owner != this || ws.head >= ws.frontier.size())
+	{
+		if (!seedStarts()) return false;
+
+		//Every start is searched from at once, so the first target reached is the nearest one to any start
+		ws.frontier.assign(ws.starts.begin(), ws.starts.end());
+		ws.head = 0;
+	}
+
+	_version++;
+
+	Node currentNode = _maze[ws.frontier[ws.head++]];
 
 	int x = currentNode.x;
 	int y = currentNode.y;
 
 	updatePos = glm::vec2(x, y);
 
-	Node north = _maze[x][y - 1];
+	Node north = node(x, y - 1);
 	if (north.type == Node::Type::UNSEARCHED && north.steps == -1)
 	{
 		north.parent = Node::Direction::SOUTH;
 		north.steps = currentNode.steps + 1;
 		north.type = Node::Type::SEARCHED;
 
-		unsearched.push_back(north);
-		_maze[x][y - 1] = north;
+		ws.frontier.push_back(x * _ySize + y - 1);
+		node(x, y - 1) = north;
+
+		markSearched(x, y - 1);
 	}
 	else if (north.type == Node::Type::TARGET)
 	{
 		north.parent = Node::Direction::SOUTH;
 		north.steps = currentNode.steps + 1;
-		_maze[x][y - 1] = north;
+		node(x, y - 1) = north;
+
+		_reachedX = x;
+		_reachedY = y - 1;
 
-		//Clear unsearched so that it starts empty if the function is needed again
-		unsearched.clear();
+		//Clear the frontier so that it starts empty if the function is needed again
+		ws.frontier.clear();
+		ws.head = 0;
 		return false;
 	}
 
-	Node south = _maze[x][y + 1];
+	Node south = node(x, y + 1);
 	if (south.type == Node::Type::UNSEARCHED && south.steps == -1)
 	{
 		south.parent = Node::Direction::NORTH;
 		south.steps = currentNode.steps + 1;
 		south.type = Node::Type::SEARCHED;
 
-		unsearched.push_back(south);
-		_maze[x][y + 1] = south;
+		ws.frontier.push_back(x * _ySize + y + 1);
+		node(x, y + 1) = south;
+
+		markSearched(x, y + 1);
 	}
 	else if (south.type == Node::Type::TARGET)
 	{
 		south.parent = Node::Direction::NORTH;
 		south.steps = currentNode.steps + 1;
-		_maze[x][y + 1] = south;
+		node(x, y + 1) = south;
+
+		_reachedX = x;
+		_reachedY = y + 1;
 
-		//Clear unsearched so that it starts empty if the function is needed again
-		unsearched.clear();
+		//Clear the frontier so that it starts empty if the function is needed again
+		ws.frontier.clear();
+		ws.head = 0;
 		return false;
 	}
 
-	Node east = _maze[x + 1][y];
+	Node east = node(x + 1, y);
 	if (east.type == Node::Type::UNSEARCHED && east.steps == -1)
 	{
 		east.parent = Node::Direction::WEST;
 		east.steps = currentNode.steps + 1;
 		east.type = Node::Type::SEARCHED;
 
-		unsearched.push_back(east);
-		_maze[x + 1][y] = east;
+		ws.frontier.push_back((x + 1) * _ySize + y);
+		node(x + 1, y) = east;
+
+		markSearched(x + 1, y);
 	}
 	else if (east.type == Node::Type::TARGET)
 	{
 		east.parent = Node::Direction::WEST;
 		east.steps = currentNode.steps + 1;
-		_maze[x + 1][y] = east;
+		node(x + 1, y) = east;
+
+		_reachedX = x + 1;
+		_reachedY = y;
 
-		//Clear unsearched so that it starts empty if the function is needed again
-		unsearched.clear();
+		//Clear the frontier so that it starts empty if the function is needed again
+		ws.frontier.clear();
+		ws.head = 0;
 		return false;
 	}
 
-	Node west = _maze[x - 1][y];
+	Node west = node(x - 1, y);
 	if (west.type == Node::Type::UNSEARCHED && west.steps == -1)
 	{
 		west.parent = Node::Direction::EAST;
 		west.steps = currentNode.steps + 1;
 		west.type = Node::Type::SEARCHED;
 
-		unsearched.push_back(west);
-		_maze[x - 1][y] = west;
+		ws.frontier.push_back((x - 1) * _ySize + y);
+		node(x - 1, y) = west;
+
+		markSearched(x - 1, y);
 	}
 	else if (west.type == Node::Type::TARGET)
 	{
 		west.parent = Node::Direction::EAST;
 		west.steps = currentNode.steps + 1;
-		_maze[x - 1][y] = west;
+		node(x - 1, y) = west;
+
+		_reachedX = x - 1;
+		_reachedY = y;
 
-		//Clear unsearched so that it starts empty if the function is needed again
-		unsearched.clear();
+		//Clear the frontier so that it starts empty if the function is needed again
+		ws.frontier.clear();
+		ws.head = 0;
 		return false;
 	}
 
 	return true;
 }
 
+void Maze::relax(int x, int y, int steps, Node::Direction parent)
+{
+	Node &next = node(x, y);
+	if (next.type == Node::Type::WALL || next.type == Node::Type::START) return;
+
+	steps += next.weight;
+	if (next.steps != -1 && next.steps <= steps) return;
+
+	if (next.type == Node::Type::UNSEARCHED)
+	{
+		next.type = Node::Type::SEARCHED;
+		markSearched(x, y);
+	}
+
+	next.steps = steps;
+	next.parent = parent;
+
+	//Cheaper routes leave the old entry behind, it is skipped when its bucket comes up
+	SolverWorkspace &ws = getWorkspace();
+	ws.buckets[steps % ws.bucketCount].push_back(x * _ySize + y);
+	ws.queued++;
+}
+
+bool Maze::stepWeighted(glm::vec2 &updatePos)
+{
+	SolverWorkspace &ws = getWorkspace();
+	if (ws.owner != this || ws.queued == 0)
+	{
+		if (!seedStarts()) return false;
+
+		//Costs in the queue never span more than the largest weight, so the buckets can be reused in a ring
+		ws.bucketCount = _maxWeight + 1;
+		if (ws.buckets.size() < (size_t)ws.bucketCount) ws.buckets.resize(ws.bucketCount);
+		for (std::vector<int> &bucket : ws.buckets)
+		{
+			bucket.clear();
+		}
+
+		ws.bucketCost = 0;
+		ws.buckets[0].assign(ws.starts.begin(), ws.starts.end());
+		ws.queued = ws.starts.size();
+	}
+
+	_version++;
+
+	//Find the cheapest cell that is still current
+	Node current;
+	while (true)
+	{
+		std::vector<int> &bucket = ws.buckets[ws.bucketCost % ws.bucketCount];
+		if (bucket.size() == 0)
+		{
+			ws.bucketCost++;
+			continue;
+		}
+
+		current = _maze[bucket.back()];
+		bucket.pop_back();
+		ws.queued--;
+
+		if (current.steps == ws.bucketCost) break;
+		if (ws.queued == 0) return false;
+	}
+
+	int x = current.x;
+	int y = current.y;
+
+	updatePos = glm::vec2(x, y);
+
+	//Unlike breadth first search, a target is only final once it is the cheapest cell left
+	if (current.type == Node::Type::TARGET)
+	{
+		_reachedX = x;
+		_reachedY = y;
+
+		//Empty the queue so that it starts empty if the function is needed again
+		for (std::vector<int> &bucket : ws.buckets)
+		{
+			bucket.clear();
+		}
+		ws.queued = 0;
+		return false;
+	}
+
+	relax(x, y - 1, current.steps, Node::Direction::SOUTH);
+	relax(x, y + 1, current.steps, Node::Direction::NORTH);
+	relax(x + 1, y, current.steps, Node::Direction::WEST);
+	relax(x - 1, y, current.steps, Node::Direction::EAST);
+
+	return ws.queued != 0;
+}
+
 bool Maze::stepTrace(glm::vec2 &updatePos)
 {
-	static Node currentNode;
-	if (currentNode.x == -1)
+	SolverWorkspace &ws = getWorkspace();
+
+	Node currentNode;
+	if (ws.owner != this || ws.traceX == -1)
 	{
-		currentNode = getTarget();
+		currentNode = getSolvedTarget();
+		if (currentNode.x == -1) return false;
+
+		ws.owner = this;
 	}
+	else currentNode = node(ws.traceX, ws.traceY);
 
 	if (currentNode.type == Node::Type::START)
 	{
-		currentNode = Node();
+		ws.traceX = -1;
+		ws.traceY = -1;
 		return false;
 	}
 
+	_version++;
 	updatePos = glm::vec2(currentNode.x, currentNode.y);
 
 	//Mark the current node as traced as long as it is empty
-	_maze[currentNode.x][currentNode.y].type = currentNode.type == Node::Type::SEARCHED ? Node::Type::TRACED : currentNode.type;
+	node(currentNode.x, currentNode.y).type = currentNode.type == Node::Type::SEARCHED ? Node::Type::TRACED : currentNode.type;
+	if (currentNode.type == Node::Type::SEARCHED) markTraced(currentNode.x, currentNode.y);
 
-	switch (currentNode.parent)
-	{
-	case Node::Direction::NORTH:
-		currentNode = _maze[currentNode.x][currentNode.y - 1];
-		break;
+	ws.traceX = currentNode.x;
+	ws.traceY = currentNode.y;
+	follow(ws.traceX, ws.traceY, currentNode.parent);
 
-	case Node::Direction::SOUTH:
-		currentNode = _maze[currentNode.x][currentNode.y + 1];
-		break;
+	return true;
+}
 
-	case Node::Direction::EAST:
-		currentNode = _maze[currentNode.x + 1][currentNode.y];
-		break;
+Node::Direction Maze::opposite(Node::Direction dir)
+{
+	int back = 0;
+	if (dir & Node::Direction::NORTH) back |= Node::Direction::SOUTH;
+	if (dir & Node::Direction::SOUTH) back |= Node::Direction::NORTH;
+	if (dir & Node::Direction::EAST) back |= Node::Direction::WEST;
+	if (dir & Node::Direction::WEST) back |= Node::Direction::EAST;
 
-	case Node::Direction::WEST:
-		currentNode = _maze[currentNode.x - 1][currentNode.y];
-		break;
-	}
+	return Node::Direction(back);
+}
 
-	return true;
+void Maze::follow(int &x, int &y, Node::Direction dir)
+{
+	//Diagonal directions have two bits set and move on both axes
+	if (dir & Node::Direction::NORTH) y--;
+	if (dir & Node::Direction::SOUTH) y++;
+	if (dir & Node::Direction::EAST) x++;
+	if (dir & Node::Direction::WEST) x--;
 }
 
 int Maze::process()
 {
-	//Loop runs until it runs out of nodes to search or the solution is found
-	while (stepProcess());
+	return process(Neighbourhood::FOUR_CONNECTED);
+}
+
+template <class Neighbours, class Stop>
+int Maze::processKernel(StateLayout layout, int targetCount)
+{
+	if (layout == StateLayout::NODE_LAYOUT) return Kernels::solve<Neighbours, Stop, Kernels::NodeLayout>(_maze.data(), _xSize, _ySize, targetCount, getWorkspace());
+
+	return Kernels::solve<Neighbours, Stop, Kernels::CompactLayout>(_maze.data(), _xSize, _ySize, targetCount, getWorkspace());
+}
+
+int Maze::process(Neighbourhood neighbourhood, StopPolicy stop, StateLayout layout)
+{
+	//Straight moves can't cross between components, so there is nothing to search for
+	if (neighbourhood == Neighbourhood::FOUR_CONNECTED && (_connectivity.isValid() || _rejectUnreachable) && !getConnectivity().startsReachTargets())
+	{
+		_reachedX = -1;
+		_reachedY = -1;
+		return -1;
+	}
+
+	if (_maxWeight > 1 || _log)
+	{
+		//Loop runs until it runs out of nodes to search or the solution is found
+		while (stepProcess());
+
+		return getSteps();
+	}
+
+	SolverWorkspace &ws = getWorkspace();
+	_searched = true;
+
+	//Find the starts and count the targets in a single pass
+	ws.starts.clear();
+	int targetCount = 0;
+	for (size_t i = 0; i < _maze.size(); i++)
+	{
+		if (_maze[i].type == Node::Type::START) ws.starts.push_back(i);
+		else if (_maze[i].type == Node::Type::TARGET) targetCount++;
+	}
+
+	//Make sure start hasn't already been used
+	if (ws.starts.size() == 0 || _maze[ws.starts[0]].steps != -1) return getSteps();
+
+	_version++;
 
-	return getTarget().steps;
+	//Pick the specialised kernel once, so nothing is decided per cell
+	int reached = -1;
+	if (neighbourhood == Neighbourhood::FOUR_CONNECTED)
+	{
+		if (stop == StopPolicy::FIRST_TARGET) reached = processKernel<Kernels::FourConnected, Kernels::FirstTarget>(layout, targetCount);
+		else if (stop == StopPolicy::ALL_TARGETS) reached = processKernel<Kernels::FourConnected, Kernels::AllTargets>(layout, targetCount);
+		else reached = processKernel<Kernels::FourConnected, Kernels::FullField>(layout, targetCount);
+	}
+	else
+	{
+		if (stop == StopPolicy::FIRST_TARGET) reached = processKernel<Kernels::EightConnected, Kernels::FirstTarget>(layout, targetCount);
+		else if (stop == StopPolicy::ALL_TARGETS) reached = processKernel<Kernels::EightConnected, Kernels::AllTargets>(layout, targetCount);
+		else reached = processKernel<Kernels::EightConnected, Kernels::FullField>(layout, targetCount);
+	}
+
+	_reachedX = reached == -1 ? -1 : reached / _ySize;
+	_reachedY = reached == -1 ? -1 : reached % _ySize;
+
+	ws.track();
+	return getSteps();
 }
 
 void Maze::trace()
@@ -311,67 +713,258 @@ void Maze::trace()
 
 void Maze::reset()
 {
-	for (int i = 1; i < _maze.size() - 1; i++)
+	_version++;
+	_reachedX = -1;
+	_reachedY = -1;
+
+	//Drop any search or trace that was part way through
+	SolverWorkspace &ws = getWorkspace();
+	if (ws.owner == this)
 	{
-		for (int o = 1; o < _maze[0].size() - 1; o++)
+		ws.frontier.clear();
+		ws.head = 0;
+		for (std::vector<int> &bucket : ws.buckets)
 		{
-			_maze[i][o].steps = -1;
-			_maze[i][o].parent = Node::Direction::NONE;
+			bucket.clear();
+		}
+		ws.queued = 0;
+		ws.traceX = -1;
+		ws.traceY = -1;
+	}
 
-			if (_maze[i][o].type == Node::Type::SEARCHED || _maze[i][o].type == Node::Type::TRACED)
+	//Nothing has marked the grid since it was loaded, generated or last reset
+	if (!_searched) return;
+	_searched = false;
+
+	for (int i = 1; i < _xSize - 1; i++)
+	{
+		for (int o = 1; o < _ySize - 1; o++)
+		{
+			node(i, o).steps = -1;
+			node(i, o).parent = Node::Direction::NONE;
+
+			if (node(i, o).type == Node::Type::SEARCHED || node(i, o).type == Node::Type::TRACED)
 			{
-				_maze[i][o].type = Node::Type::UNSEARCHED;
+				node(i, o).type = Node::Type::UNSEARCHED;
 			}
 		}
 	}
 }
 
-void Maze::getType(std::vector<std::vector<Node::Type>> &output) const
+bool Maze::getPath(Path &path) const
 {
-	output.clear();
+	path.clear(_reachedX, _reachedY);
+	if (_reachedX == -1) return false;
 
-	for (int i = 0; i < _maze.size(); i++)
+	//Parents point back towards the start, so the path is built from the target and turned around at the end
+	int x = _reachedX;
+	int y = _reachedY;
+	while (node(x, y).type != Node::Type::START)
 	{
-		std::vector<Node::Type> tmpVector;
+		Node::Direction parent = node(x, y).parent;
+		if (parent == Node::Direction::NONE) return false;
 
-		for (int o = 0; o < _maze[0].size(); o++)
+		//Diagonals go around whichever of their two corners isn't a wall
+		Node::Direction vertical = Node::Direction(parent & (Node::Direction::NORTH | Node::Direction::SOUTH));
+		Node::Direction horizontal = Node::Direction(parent & (Node::Direction::EAST | Node::Direction::WEST));
+		if (vertical != Node::Direction::NONE && horizontal != Node::Direction::NONE)
 		{
-			tmpVector.push_back(_maze[i][o].type);
+			int cornerX = x;
+			int cornerY = y;
+			follow(cornerX, cornerY, vertical);
+
+			if (node(cornerX, cornerY).type == Node::Type::WALL) std::swap(vertical, horizontal);
+
+			path.push(vertical);
+			path.push(horizontal);
 		}
+		else path.push(parent);
 
-		output.push_back(tmpVector);
+		follow(x, y, parent);
+	}
+
+	path.reverse();
+
+	return true;
+}
+
+bool Maze::trace(Path &path, bool mark)
+{
+	if (!getPath(path)) return false;
+	if (!mark) return true;
+
+	_version++;
+
+	int x = path.getStartX();
+	int y = path.getStartY();
+	for (Node::Direction move : path)
+	{
+		follow(x, y, move);
+
+		//Start and target keep their own types, just like stepTrace
+		Node &current = node(x, y);
+		if (current.type != Node::Type::SEARCHED) continue;
+
+		current.type = Node::Type::TRACED;
+		markTraced(x, y);
+	}
+
+	return true;
+}
+
+void Maze::applySolution(const Path &path, int steps)
+{
+	_version++;
+	_searched = true;
+
+	int x = path.getStartX();
+	int y = path.getStartY();
+	node(x, y).steps = 0;
+
+	for (Node::Direction move : path)
+	{
+		Node &previous = node(x, y);
+		follow(x, y, move);
+
+		//Parents are filled in so that tracing and getSolvedStart still work
+		Node &current = node(x, y);
+		current.parent = opposite(move);
+		current.steps = previous.steps + current.weight;
+
+		if (current.type == Node::Type::UNSEARCHED || current.type == Node::Type::SEARCHED) current.type = Node::Type::TRACED;
+	}
+
+	node(x, y).steps = steps;
+	_reachedX = x;
+	_reachedY = y;
+}
+
+//Only walls, starts and targets decide what is connected, marking cells searched or traced doesn't
+static bool affectsConnectivity(Node::Type type)
+{
+	return type == Node::Type::WALL || type == Node::Type::START || type == Node::Type::TARGET;
+}
+
+void Maze::setType(int x, int y, Node::Type type)
+{
+	Node::Type old = node(x, y).type;
+	if (old != type && (affectsConnectivity(old) || affectsConnectivity(type))) _connectivity.clear();
+
+	if (type == Node::Type::SEARCHED || type == Node::Type::TRACED) _searched = true;
+
+	node(x, y).type = type;
+	_version++;
+}
+
+const Connectivity &Maze::getConnectivity()
+{
+	if (!_connectivity.isValid()) _connectivity.build(*this, getWorkspace());
+
+	return _connectivity;
+}
+
+void Maze::getType(std::vector<std::vector<Node::Type>> &output) const
+{
+	TypeView view = getView();
+
+	output.resize(_xSize);
+	for (int i = 0; i < _xSize; i++)
+	{
+		TypeView::Line column = view.column(i);
+		output[i].assign(column.begin(), column.end());
 	}
 }
 
 void Maze::print() const
 {
 	std::cout << std::endl;
+	write(std::cout);
+}
 
-	for (int o = 0; o < _maze[0].size(); o++)
+void Maze::printParent() const
+{
+	std::cout << std::endl;
+	write(std::cout, true);
+}
+
+void Maze::writeRows(int firstRow, int lastRow, bool parents, std::vector<char> &out) const
+{
+	size_t lineSize = (size_t)_xSize + 1;
+	out.resize(lineSize * (lastRow - firstRow));
+
+	//Walk each column down the block so the nodes are read in storage order
+	for (int i = 0; i < _xSize; i++)
 	{
-		for (int i = 0; i < _maze.size(); i++)
+		const Node *column = &node(i, firstRow);
+		char *text = &out[i];
+
+		for (int o = 0; o < lastRow - firstRow; o++)
 		{
-			std::cout << (char)_maze[i][o].type;
+			Node::Type type = column[o].type;
+
+			//The weight is what load needs to reproduce the maze, so it wins over searched and traced marks
+			if (parents && type == Node::Type::SEARCHED) *text = '0' + column[o].parent;
+			else if (column[o].weight > 1 && (type == Node::Type::UNSEARCHED || type == Node::Type::SEARCHED || type == Node::Type::TRACED)) *text = '0' + column[o].weight;
+			else *text = (char)type;
+
+			text += lineSize;
 		}
+	}
 
-		std::cout << std::endl;
+	for (size_t line = lineSize - 1; line < out.size(); line += lineSize)
+	{
+		out[line] = '\n';
 	}
 }
 
-void Maze::printParent() const
+void Maze::write(std::ostream &output, bool parents) const
 {
-	std::cout << std::endl;
+	//Rows per block, enough to make each write large while keeping the columns of a block in cache
+	const int blockRows = 64;
+
+	WorkerPool &pool = WorkerPool::shared();
+	int threadCount = pool.getThreadCount();
+	int blockCount = (_ySize + blockRows - 1) / blockRows;
 
-	for (int o = 0; o < _maze[0].size(); o++)
+	//Blocks are formatted a round at a time on every core, then written out in order
+	std::vector<std::vector<char>> blocks(threadCount);
+	for (int roundStart = 0; roundStart < blockCount; roundStart += threadCount)
 	{
-		for (int i = 0; i < _maze.size(); i++)
+		int roundCount = std::min(threadCount, blockCount - roundStart);
+
+		pool.forEach(roundCount, [&](int block)
+		{
+			int firstRow = (roundStart + block) * blockRows;
+			writeRows(firstRow, std::min(_ySize, firstRow + blockRows), parents, blocks[block]);
+		});
+
+		for (int block = 0; block < roundCount; block++)
 		{
-			if(_maze[i][o].type == Node::Type::SEARCHED) std::cout << _maze[i][o].parent;
-			else std::cout << (char)_maze[i][o].type;
+			output.write(blocks[block].data(), blocks[block].size());
 		}
+	}
 
-		std::cout << std::endl;
+	output.flush();
+}
+
+bool Maze::save(const std::string &path, bool parents) const
+{
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cout << "Could not open file to save maze at: " << path << std::endl;
+		return false;
 	}
+
+	write(output, parents);
+
+	if (!output.good())
+	{
+		std::cout << "Failed while saving maze to: " << path << std::endl;
+		return false;
+	}
+
+	return true;
 }
 
 void Maze::generate(int xSize, int ySize)
@@ -388,20 +981,31 @@ void Maze::generate(int xSize, int ySize)
 	if (xSize % 2 == 0) xSize++;
 	if (ySize % 2 == 0) ySize++;
 
+	//Clearing keeps the grid's memory, so regenerating at the same size or smaller doesn't allocate
+	size_t capacity = _maze.capacity();
 	_maze.clear();
+	_xSize = xSize + 2;
+	_ySize = ySize + 2;
+	_version++;
+	_layoutVersion++;
+	_connectivity.clear();
+	_searched = false;
+	_reachedX = -1;
+	_reachedY = -1;
+	_maxWeight = 1;
 
 	//Fill the grid with empty nodes
-	for (int i = 0; i < xSize + 2; i++)
+	for (int i = 0; i < _xSize; i++)
 	{
-		std::vector<Node> tmpVec;
-		for (int o = 0; o < ySize + 2; o++)
+		for (int o = 0; o < _ySize; o++)
 		{
-			tmpVec.push_back(Node(Node::Type::WALL, i, o));
+			_maze.push_back(Node(Node::Type::WALL, i, o));
 		}
-
-		_maze.push_back(tmpVec);
 	}
 
+	SolverWorkspace &ws = getWorkspace();
+	if (_maze.capacity() != capacity) ws.countAllocation();
+
 	//Choose start and target points that aren't too close together
 	int startX = 0;
 	int startY = 0;
@@ -425,58 +1029,60 @@ void Maze::generate(int xSize, int ySize)
 		targetY += 1;
 	} while (targetX == startX && targetY == startY && distance(startX, startY, targetX, targetY) > distance(0, 0, xSize, ySize) / 2);
 
-	_maze[startX][startY].type = Node::Type::START;
-	_maze[targetX][targetY].type = Node::Type::TARGET;
+	node(startX, startY).type = Node::Type::START;
+	node(targetX, targetY).type = Node::Type::TARGET;
 
 	//Start generation at the maze start
-	std::vector<Node> stack;
-	stack.push_back(getStart());
+	std::vector<int> &stack = ws.stack;
+	stack.clear();
+	stack.push_back(startX * _ySize + startY);
 
 	//Generate the maze
 	while (stack.size() != 0)
 	{
-		Node back = stack.back();
+		Node back = _maze[stack.back()];
 
 		Node::Direction dir = Node::Direction::NONE;
-		std::vector<Node::Direction> validDirs;
+		Node::Direction validDirs[4];
+		int validCount = 0;
 
-		if (back.y > 1 && _maze[back.x][back.y - 2].type == Node::Type::WALL) validDirs.push_back(Node::Direction::NORTH);
-		if (back.y < ySize - 1 && _maze[back.x][back.y + 2].type == Node::Type::WALL) validDirs.push_back(Node::Direction::SOUTH);
-		if (back.x < xSize - 1 && _maze[back.x + 2][back.y].type == Node::Type::WALL) validDirs.push_back(Node::Direction::EAST);
-		if (back.x > 1 && _maze[back.x - 2][back.y].type == Node::Type::WALL) validDirs.push_back(Node::Direction::WEST);
+		if (back.y > 1 && node(back.x, back.y - 2).type == Node::Type::WALL) validDirs[validCount++] = Node::Direction::NORTH;
+		if (back.y < ySize - 1 && node(back.x, back.y + 2).type == Node::Type::WALL) validDirs[validCount++] = Node::Direction::SOUTH;
+		if (back.x < xSize - 1 && node(back.x + 2, back.y).type == Node::Type::WALL) validDirs[validCount++] = Node::Direction::EAST;
+		if (back.x > 1 && node(back.x - 2, back.y).type == Node::Type::WALL) validDirs[validCount++] = Node::Direction::WEST;
 
 		//If no valid direction then continue without setting one
-		if (validDirs.size() != 0) dir = validDirs[rand() % validDirs.size()];
+		if (validCount != 0) dir = validDirs[rand() % validCount];
 
 		switch (dir)
 		{
 			case Node::Direction::NORTH:
-				_maze[back.x][back.y - 1].type = Node::Type::UNSEARCHED;
-				_maze[back.x][back.y - 2].type = Node::Type::UNSEARCHED;
+				node(back.x, back.y - 1).type = Node::Type::UNSEARCHED;
+				node(back.x, back.y - 2).type = Node::Type::UNSEARCHED;
 
 				//Branch off of the next point before continuing on this point
-				stack.push_back(_maze[back.x][back.y - 2]);
+				stack.push_back(back.x * _ySize + back.y - 2);
 				continue;
 
 			case Node::Direction::SOUTH:
-				_maze[back.x][back.y + 1].type = Node::Type::UNSEARCHED;
-				_maze[back.x][back.y + 2].type = Node::Type::UNSEARCHED;
+				node(back.x, back.y + 1).type = Node::Type::UNSEARCHED;
+				node(back.x, back.y + 2).type = Node::Type::UNSEARCHED;
 
-				stack.push_back(_maze[back.x][back.y + 2]);
+				stack.push_back(back.x * _ySize + back.y + 2);
 				continue;
 
 			case Node::Direction::EAST:
-				_maze[back.x + 1][back.y].type = Node::Type::UNSEARCHED;
-				_maze[back.x + 2][back.y].type = Node::Type::UNSEARCHED;
+				node(back.x + 1, back.y).type = Node::Type::UNSEARCHED;
+				node(back.x + 2, back.y).type = Node::Type::UNSEARCHED;
 
-				stack.push_back(_maze[back.x + 2][back.y]);
+				stack.push_back((back.x + 2) * _ySize + back.y);
 				continue;
 
 			case Node::Direction::WEST:
-				_maze[back.x - 1][back.y].type = Node::Type::UNSEARCHED;
-				_maze[back.x - 2][back.y].type = Node::Type::UNSEARCHED;
+				node(back.x - 1, back.y).type = Node::Type::UNSEARCHED;
+				node(back.x - 2, back.y).type = Node::Type::UNSEARCHED;
 
-				stack.push_back(_maze[back.x - 2][back.y]);
+				stack.push_back((back.x - 2) * _ySize + back.y);
 				continue;
 
 			default:
@@ -485,36 +1091,39 @@ void Maze::generate(int xSize, int ySize)
 	}
 
 	//Connect the target to the maze
-	Node target = getTarget();
+	Node target = node(targetX, targetY);
 
 	Node::Direction dir = Node::Direction::NONE;
-	std::vector<Node::Direction> validDirs;
+	Node::Direction validDirs[4];
+	int validCount = 0;
 
-	if (target.y > 1 && _maze[target.x][target.y - 2].type == Node::Type::UNSEARCHED) validDirs.push_back(Node::Direction::NORTH);
-	if (target.y < ySize - 1 && _maze[target.x][target.y + 2].type == Node::Type::UNSEARCHED) validDirs.push_back(Node::Direction::SOUTH);
-	if (target.x < xSize - 1 && _maze[target.x + 2][target.y].type == Node::Type::UNSEARCHED) validDirs.push_back(Node::Direction::EAST);
-	if (target.x > 1 && _maze[target.x - 2][target.y].type == Node::Type::UNSEARCHED) validDirs.push_back(Node::Direction::WEST);
+	if (target.y > 1 && node(target.x, target.y - 2).type == Node::Type::UNSEARCHED) validDirs[validCount++] = Node::Direction::NORTH;
+	if (target.y < ySize - 1 && node(target.x, target.y + 2).type == Node::Type::UNSEARCHED) validDirs[validCount++] = Node::Direction::SOUTH;
+	if (target.x < xSize - 1 && node(target.x + 2, target.y).type == Node::Type::UNSEARCHED) validDirs[validCount++] = Node::Direction::EAST;
+	if (target.x > 1 && node(target.x - 2, target.y).type == Node::Type::UNSEARCHED) validDirs[validCount++] = Node::Direction::WEST;
 
-	dir = validDirs[rand() % validDirs.size()];
+	dir = validDirs[rand() % validCount];
 
 	switch (dir)
 	{
 		case Node::Direction::NORTH:
-			_maze[target.x][target.y - 1].type = Node::Type::UNSEARCHED;
+			node(target.x, target.y - 1).type = Node::Type::UNSEARCHED;
 			break;
 
 		case Node::Direction::SOUTH:
-			_maze[target.x][target.y + 1].type = Node::Type::UNSEARCHED;
+			node(target.x, target.y + 1).type = Node::Type::UNSEARCHED;
 			break;
 
 		case Node::Direction::EAST:
-			_maze[target.x + 1][target.y].type = Node::Type::UNSEARCHED;
+			node(target.x + 1, target.y).type = Node::Type::UNSEARCHED;
 			break;
 
 		case Node::Direction::WEST:
-			_maze[target.x - 1][target.y].type = Node::Type::UNSEARCHED;
+			node(target.x - 1, target.y).type = Node::Type::UNSEARCHED;
 			break;
 	}
+
+	ws.track();
 }
 
 int Maze::distance(int x1, int y1, int x2, int y2) const
@@ -1,13 +1,21 @@
 #ifndef MAZE_H
 #define MAZE_H
 
+#include <cstddef>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
 
 #include <glm/vec2.hpp>
 
+#include "Connectivity.h"
+#include "SolverWorkspace.h"
+
+class Path;
+class SearchLog;
+
 struct Node
 {
 	enum Direction
@@ -30,7 +38,10 @@ struct Node
 
 	int x;
 	int y;
-	int steps = -1;	//Steps from the start
+	int steps = -1;	//Steps from the start, or the total cost of getting here on weighted mazes
+
+	//Cost of stepping onto this cell, written as the digits 1-9 in maze files
+	unsigned char weight = 1;
 
 	//Distance from end + steps
 	int cost = -1;
@@ -61,50 +72,249 @@ private:
 	}
 };
 
+//Read-only window onto the type of every cell, reading the live maze without copying it
+//Cells are stored column by column, so stepping in y is contiguous and stepping in x skips a whole column
+class TypeView
+{
+public:
+	//Cells along a single row or column
+	class Line
+	{
+	public:
+		class Iterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef Node::Type value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const Node::Type *pointer;
+			typedef Node::Type reference;
+
+			Iterator(const Node *node, std::ptrdiff_t stride) : _node(node), _stride(stride) {}
+
+			Node::Type operator*() const { return _node->type; }
+			Iterator &operator++() { _node += _stride; return *this; }
+			Iterator operator++(int) { Iterator tmp = *this; _node += _stride; return tmp; }
+
+			bool operator==(const Iterator &other) const { return _node == other._node; }
+			bool operator!=(const Iterator &other) const { return _node != other._node; }
+
+		private:
+			const Node *_node;
+			std::ptrdiff_t _stride;
+		};
+
+		Line(const Node *first, int count, std::ptrdiff_t stride) : _first(first), _count(count), _stride(stride) {}
+
+		int size() const { return _count; }
+		Node::Type operator[](int i) const { return _first[i * _stride].type; }
+
+		Iterator begin() const { return Iterator(_first, _stride); }
+		Iterator end() const { return Iterator(_first + _count * _stride, _stride); }
+
+	private:
+		const Node *_first;
+		int _count;
+		std::ptrdiff_t _stride;
+	};
+
+	TypeView() {}
+	TypeView(const Node *data, int xSize, int ySize) : _data(data), _xSize(xSize), _ySize(ySize) {}
+
+	int getX() const { return _xSize; }
+	int getY() const { return _ySize; }
+
+	//Distance in nodes between neighbouring cells
+	std::ptrdiff_t getXStride() const { return _ySize; }
+	std::ptrdiff_t getYStride() const { return 1; }
+
+	Node::Type operator()(int x, int y) const { return _data[(std::ptrdiff_t)x * _ySize + y].type; }
+
+	Line row(int y) const { return Line(_data + y, _xSize, _ySize); }
+	Line column(int x) const { return Line(_data + (std::ptrdiff_t)x * _ySize, _ySize, 1); }
+
+private:
+	const Node *_data = nullptr;
+	int _xSize = 0;
+	int _ySize = 0;
+};
+
 class Maze
 {
 public:
+	//Options for the specialised solver kernels
+	enum Neighbourhood
+	{
+		FOUR_CONNECTED,
+		EIGHT_CONNECTED
+	};
+	enum StopPolicy
+	{
+		FIRST_TARGET,
+		ALL_TARGETS,
+		FULL_FIELD
+	};
+	enum StateLayout
+	{
+		NODE_LAYOUT,
+		COMPACT_LAYOUT
+	};
+
 	Maze();
 	Maze(const std::string path);
 
-	int getX() const { return _maze.size(); }
-	int getY() const { return _maze[0].size(); }
+	int getX() const { return _xSize; }
+	int getY() const { return _ySize; }
 
-	int getSteps() const { return getTarget().steps; }
+	//Steps to the target found by the last solve, -1 if none was reached
+	int getSteps() const;
 
+	//Only valid when the maze has exactly one, otherwise an invalid node is returned
 	Node getStart() const;
 	Node getTarget() const;
 
-	void load(const std::string &path);
+	std::vector<Node> getStarts() const;
+	std::vector<Node> getTargets() const;
+
+	//The start and target joined by the last solve
+	Node getSolvedStart() const;
+	Node getSolvedTarget() const;
+
+	//False with the reason printed if the file is missing or not a valid maze
+	bool load(const std::string &path);
 
 	bool stepProcess();
 	bool stepTrace();
 
+	//Searches breadth first, or with Dijkstra over a bucket queue when the maze has weighted cells
 	bool stepProcess(glm::vec2 &updatePos);
 	bool stepTrace(glm::vec2 &updatePos);
 
+	//Steps until the buffer can't hold another step's changes or the time budget in milliseconds runs out, 0 means no budget
+	//Writes the index x * getY() + y of every cell whose type changed and returns how many
+	//A search step can change up to 4 cells and a trace step 1, so capacity must be at least that
+	//done is set once there is nothing left to step, the next call then starts over like the single steps do
+	size_t stepProcess(int *changed, size_t capacity, bool &done, double budgetMS = 0.0);
+	size_t stepTrace(int *changed, size_t capacity, bool &done, double budgetMS = 0.0);
+
 	int process();
+	//Weighted mazes and recorded solves always use the stepping search, as the kernels only count steps
+	//Straight move searches are skipped if the components show no start can reach a target, which is only checked when
+	//the components are already known, unless setRejectUnreachable asks for them to be built before the first solve
+	int process(Neighbourhood neighbourhood, StopPolicy stop = StopPolicy::FIRST_TARGET, StateLayout layout = StateLayout::COMPACT_LAYOUT);
 	void trace();
+	//Reads out the solution as a path, only marking it on the grid if asked to
+	bool trace(Path &path, bool mark = true);
 
 	void reset();
 
-	Node::Type getType(int x, int y) const { return _maze[x][y].type; };
+	//Path from the solved start to the solved target without touching the grid, false if the last solve found nothing
+	bool getPath(Path &path) const;
+	//Marks a known solution as if it had been solved and traced, steps is its length or cost
+	void applySolution(const Path &path, int steps);
+
+	Node::Type getType(int x, int y) const { return node(x, y).type; };
+	int getWeight(int x, int y) const { return node(x, y).weight; }
+	bool isWeighted() const { return _maxWeight > 1; }
+	void setType(int x, int y, Node::Type type);
+	//Copies every type, getView reads them in place and is far cheaper
 	void getType(std::vector<std::vector<Node::Type>> &output) const;
 
+	//The view stays valid until the maze is loaded or generated again
+	TypeView getView() const { return TypeView(_maze.data(), _xSize, _ySize); }
+
+	//Changes whenever any cell changes, so readers can tell if their copy is stale
+	unsigned long long getVersion() const { return _version; }
+	//Changes only when the maze is loaded or generated, which also invalidates views
+	unsigned long long getLayoutVersion() const { return _layoutVersion; }
+
+	//Components of the open cells, built on first use and again after walls, starts or targets change
+	const Connectivity &getConnectivity();
+	//Building the components costs about as much as a search, so it only pays for mazes that are often unsolvable
+	//or solved many times between changes to their walls, starts and targets
+	void setRejectUnreachable(bool reject) { _rejectUnreachable = reject; }
+
 	void print() const;
 	void printParent() const;
 
+	//Writes the maze with its solution in the format load reads, parents replaces searched cells with their parent direction
+	//Weighted cells keep their digit even once searched or traced, so a saved weighted maze reloads to the same costs
+	void write(std::ostream &output, bool parents = false) const;
+	bool save(const std::string &path, bool parents = false) const;
+
 	void generate(int xSize, int ySize);
 
+	//Optionally record the order cells are searched and traced, nullptr stops recording
+	void setLog(SearchLog *log) { _log = log; }
+
+	//Shares scratch buffers between mazes, nullptr goes back to the maze's own workspace
+	void setWorkspace(SolverWorkspace *workspace) { _workspace = workspace; }
+	SolverWorkspace &getWorkspace() { return _workspace ? *_workspace : _ownWorkspace; }
+
 private:
 	int distance(int x1, int y1, int x2, int y2) const;
 
+	void find(Node::Type type, std::vector<Node> &output) const;
+
+	//Moves x and y one cell in the given direction, including diagonals
+	static void follow(int &x, int &y, Node::Direction dir);
+	static Node::Direction opposite(Node::Direction dir);
+
+	template <class Neighbours, class Stop>
+	int processKernel(StateLayout layout, int targetCount);
+
+	//Collects the starts into the workspace and marks them, false if there are none or they were already used
+	bool seedStarts();
+
+	size_t stepBatch(int *changed, size_t capacity, bool &done, double budgetMS, bool tracing);
+
+	//Report a cell that just changed type to the log and to the batch being stepped
+	void markSearched(int x, int y);
+	void markTraced(int x, int y);
+
+	bool stepBreadthFirst(glm::vec2 &updatePos);
+	bool stepWeighted(glm::vec2 &updatePos);
+	void relax(int x, int y, int steps, Node::Direction parent);
+
+	//Formats rows [firstRow, lastRow) as text lines
+	void writeRows(int firstRow, int lastRow, bool parents, std::vector<char> &out) const;
+
 	void heapAdd(std::vector<Node> &heap, Node toAdd);
 	Node heapPop(std::vector<Node> &heap);
 
-	std::vector<std::vector<Node>> _maze;
+	Node &node(int x, int y) { return _maze[(size_t)x * _ySize + y]; }
+	const Node &node(int x, int y) const { return _maze[(size_t)x * _ySize + y]; }
+
+	//Cells stored column by column, cell (x, y) is at x * _ySize + y
+	std::vector<Node> _maze;
+	int _xSize = 0;
+	int _ySize = 0;
+
+	unsigned long long _version = 0;
+	unsigned long long _layoutVersion = 0;
 
 	bool solved = false;
+
+	int _maxWeight = 1;
+
+	Connectivity _connectivity;
+	bool _rejectUnreachable = false;
+
+	//Set once a solve or trace has marked the grid, so reset can skip a grid that is already clean
+	bool _searched = false;
+
+	SolverWorkspace _ownWorkspace;
+	SolverWorkspace *_workspace = nullptr;
+
+	//Target reached by the last solve
+	int _reachedX = -1;
+	int _reachedY = -1;
+
+	SearchLog *_log = nullptr;
+
+	//Buffer the current batched step writes changed cells into, nullptr outside of one
+	int *_batch = nullptr;
+	size_t _batchCount = 0;
 };
 
 #endif
\ No newline at end of file
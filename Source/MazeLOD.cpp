@@ -0,0 +1,181 @@
+#include "MazeLOD.h"
+
+#include <algorithm>
+
+#include "Color.h"
+#include "WorkerPool.h"
+
+MazeLOD::MazeLOD(const Maze &maze) : _maze(maze)
+{
+}
+
+static void accumulate(MazeLOD::Summary &block, const MazeLOD::Summary &add)
+{
+	block.cells += add.cells;
+	block.walls += add.walls;
+	block.searched += add.searched;
+	block.traced += add.traced;
+	block.starts += add.starts;
+	block.targets += add.targets;
+}
+
+int MazeLOD::getWidth(int level) const
+{
+	return (_maze.getX() + (1 << level) - 1) >> level;
+}
+
+int MazeLOD::getHeight(int level) const
+{
+	return (_maze.getY() + (1 << level) - 1) >> level;
+}
+
+void MazeLOD::summariseCells(int x, int y, int size, Summary &out) const
+{
+	out = Summary();
+
+	TypeView view = _maze.getView();
+
+	int xEnd = std::min(_maze.getX(), x + size);
+	int yEnd = std::min(_maze.getY(), y + size);
+	for (int i = x; i < xEnd; i++)
+	{
+		TypeView::Line column = view.column(i);
+		for (int o = y; o < yEnd; o++)
+		{
+			out.cells++;
+
+			switch (column[o])
+			{
+			case Node::Type::WALL:
+				out.walls++;
+				break;
+
+			case Node::Type::SEARCHED:
+				out.searched++;
+				break;
+
+			case Node::Type::TRACED:
+				out.traced++;
+				break;
+
+			case Node::Type::START:
+				out.starts++;
+				break;
+
+			case Node::Type::TARGET:
+				out.targets++;
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+}
+
+void MazeLOD::build()
+{
+	_levels.clear();
+	if (_maze.getX() == 0) return;
+
+	//Stop once a single block covers the whole maze
+	int levelCount = 1;
+	while (getWidth(baseLevel + levelCount - 1) > 1 || getHeight(baseLevel + levelCount - 1) > 1) levelCount++;
+	_levels.resize(levelCount);
+
+	for (int level = 0; level < levelCount; level++)
+	{
+		int width = getWidth(baseLevel + level);
+		int height = getHeight(baseLevel + level);
+		_levels[level].resize((size_t)width * height);
+
+		//Columns of blocks are independent, so they are shared out between threads
+		WorkerPool::shared().forEach(width, [&](int i)
+		{
+			for (int o = 0; o < height; o++)
+			{
+				Summary &block = _levels[level][(size_t)i * height + o];
+
+				if (level == 0)
+				{
+					summariseCells(i << baseLevel, o << baseLevel, 1 << baseLevel, block);
+					continue;
+				}
+
+				block = getSummary(baseLevel + level - 1, i * 2, o * 2);
+				for (int child = 1; child < 4; child++)
+				{
+					int childX = i * 2 + (child & 1);
+					int childY = o * 2 + (child >> 1);
+					if (childX >= getWidth(baseLevel + level - 1) || childY >= getHeight(baseLevel + level - 1)) continue;
+
+					accumulate(block, getSummary(baseLevel + level - 1, childX, childY));
+				}
+			}
+		});
+	}
+}
+
+void MazeLOD::refresh(int x, int y)
+{
+	if (_levels.size() == 0) return;
+
+	int blockX = x >> baseLevel;
+	int blockY = y >> baseLevel;
+	summariseCells(blockX << baseLevel, blockY << baseLevel, 1 << baseLevel, _levels[0][(size_t)blockX * getHeight(baseLevel) + blockY]);
+
+	//Walk up the pyramid rebuilding each parent from its four children
+	for (int level = 1; level < (int)_levels.size(); level++)
+	{
+		blockX >>= 1;
+		blockY >>= 1;
+
+		Summary block;
+		for (int child = 0; child < 4; child++)
+		{
+			int childX = blockX * 2 + (child & 1);
+			int childY = blockY * 2 + (child >> 1);
+			if (childX >= getWidth(baseLevel + level - 1) || childY >= getHeight(baseLevel + level - 1)) continue;
+
+			accumulate(block, getSummary(baseLevel + level - 1, childX, childY));
+		}
+
+		_levels[level][(size_t)blockX * getHeight(baseLevel + level) + blockY] = block;
+	}
+}
+
+MazeLOD::Summary MazeLOD::getSummary(int level, int x, int y) const
+{
+	if (level < baseLevel || level - baseLevel >= (int)_levels.size())
+	{
+		Summary summary;
+		summariseCells(x << level, y << level, 1 << level, summary);
+		return summary;
+	}
+
+	return _levels[level - baseLevel][(size_t)x * getHeight(level) + y];
+}
+
+glm::vec3 MazeLOD::getColor(int level, int x, int y) const
+{
+	if (level == 0) return ::getColor(_maze.getType(x, y));
+
+	Summary summary = getSummary(level, x, y);
+
+	if (summary.targets > 0) return ::getColor(Node::Type::TARGET);
+	if (summary.starts > 0) return ::getColor(Node::Type::START);
+	if (summary.traced > 0) return ::getColor(Node::Type::TRACED);
+	if (summary.cells == 0) return glm::vec3(0.0, 0.0, 0.0);
+
+	float walls = (float)summary.walls / summary.cells;
+	float searched = (float)summary.searched / summary.cells;
+	float unsearched = 1.0f - walls - searched;
+
+	glm::vec3 wallColor = ::getColor(Node::Type::WALL);
+	glm::vec3 searchedColor = ::getColor(Node::Type::SEARCHED);
+	glm::vec3 unsearchedColor = ::getColor(Node::Type::UNSEARCHED);
+
+	return glm::vec3(wallColor.x * walls + searchedColor.x * searched + unsearchedColor.x * unsearched,
+		wallColor.y * walls + searchedColor.y * searched + unsearchedColor.y * unsearched,
+		wallColor.z * walls + searchedColor.z * searched + unsearchedColor.z * unsearched);
+}
@@ -0,0 +1,53 @@
+#ifndef MAZE_LOD_H
+#define MAZE_LOD_H
+
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "Maze.h"
+
+//Mipmap-like summary of a maze so the viewer only needs one value per pixel at any zoom
+//Level n covers blocks of 2^n x 2^n cells, level 0 reads the maze directly
+class MazeLOD
+{
+public:
+	struct Summary
+	{
+		unsigned int cells = 0;
+		unsigned int walls = 0;
+		unsigned int searched = 0;
+		unsigned int traced = 0;
+		unsigned int starts = 0;
+		unsigned int targets = 0;
+	};
+
+	MazeLOD(const Maze &maze);
+
+	//Rebuilds every level, needed after the maze is loaded or generated
+	void build();
+
+	//Updates the blocks above a single changed cell
+	void refresh(int x, int y);
+
+	int getLevels() const { return baseLevel + _levels.size(); }
+	int getWidth(int level) const;
+	int getHeight(int level) const;
+
+	Summary getSummary(int level, int x, int y) const;
+
+	//Average colour of a block, start, target and traced cells win so they never vanish when zoomed out
+	glm::vec3 getColor(int level, int x, int y) const;
+
+private:
+	//The smallest stored level, anything below it is cheap enough to read from the maze
+	static const int baseLevel = 2;
+
+	void summariseCells(int x, int y, int size, Summary &out) const;
+
+	const Maze &_maze;
+
+	std::vector<std::vector<Summary>> _levels;
+};
+
+#endif
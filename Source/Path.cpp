@@ -0,0 +1,113 @@
+#include "Path.h"
+
+#include <utility>
+
+//Directions for each 2 bit code, a code's opposite is the code with its low bit flipped
+const Node::Direction pathMoves[4] = { Node::Direction::NORTH, Node::Direction::SOUTH, Node::Direction::EAST, Node::Direction::WEST };
+const int pathDx[4] = { 0, 0, 1, -1 };
+const int pathDy[4] = { -1, 1, 0, 0 };
+
+static int moveCode(Node::Direction move)
+{
+	for (int code = 0; code < 4; code++)
+	{
+		if (pathMoves[code] == move) return code;
+	}
+
+	return -1;
+}
+
+Path::Path(int startX, int startY)
+{
+	clear(startX, startY);
+}
+
+void Path::clear(int startX, int startY)
+{
+	_startX = startX;
+	_startY = startY;
+	_endX = startX;
+	_endY = startY;
+
+	_size = 0;
+	_data.clear();
+}
+
+bool Path::push(Node::Direction move)
+{
+	int code = moveCode(move);
+	if (code == -1) return false;
+
+	if (_size % 4 == 0) _data.push_back(0);
+	_data[_size / 4] |= code << (_size % 4 * 2);
+	_size++;
+
+	_endX += pathDx[code];
+	_endY += pathDy[code];
+
+	return true;
+}
+
+Node::Direction Path::operator[](size_t i) const
+{
+	return pathMoves[(_data[i / 4] >> (i % 4 * 2)) & 3];
+}
+
+void Path::reverse()
+{
+	auto code = [&](size_t i) { return (_data[i / 4] >> (i % 4 * 2)) & 3; };
+	auto setCode = [&](size_t i, int value) { _data[i / 4] = (unsigned char)((_data[i / 4] & ~(3 << (i % 4 * 2))) | value << (i % 4 * 2)); };
+
+	//Swapped in place from both ends, each move flipped to its opposite, so the memory is reused
+	for (size_t i = 0; i < _size / 2; i++)
+	{
+		size_t other = _size - 1 - i;
+		int first = code(i);
+		setCode(i, code(other) ^ 1);
+		setCode(other, first ^ 1);
+	}
+
+	//The middle move of an odd length path stays where it is
+	if (_size % 2 == 1) setCode(_size / 2, code(_size / 2) ^ 1);
+
+	std::swap(_startX, _endX);
+	std::swap(_startY, _endY);
+}
+
+void Path::getCells(std::vector<glm::vec2> &output) const
+{
+	output.resize(_size + 1);
+
+	int x = _startX;
+	int y = _startY;
+	output[0] = glm::vec2(x, y);
+
+	for (size_t i = 0; i < _size; i++)
+	{
+		int code = (_data[i / 4] >> (i % 4 * 2)) & 3;
+		x += pathDx[code];
+		y += pathDy[code];
+		output[i + 1] = glm::vec2(x, y);
+	}
+}
+
+bool Path::setData(int startX, int startY, size_t count, const unsigned char *data, size_t bytes)
+{
+	if (bytes < (count + 3) / 4) return false;
+
+	clear(startX, startY);
+	_data.assign(data, data + (count + 3) / 4);
+	_size = count;
+
+	//Anything past the last move is cleared so that paths compare and store the same however they were made
+	if (count % 4 != 0) _data.back() &= (1 << (count % 4 * 2)) - 1;
+
+	for (size_t i = 0; i < _size; i++)
+	{
+		int code = (_data[i / 4] >> (i % 4 * 2)) & 3;
+		_endX += pathDx[code];
+		_endY += pathDy[code];
+	}
+
+	return true;
+}
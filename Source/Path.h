@@ -0,0 +1,81 @@
+#ifndef PATH_H
+#define PATH_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "Maze.h"
+
+//A route through a maze as its start cell and 2 bits per move, so even long paths are cheap to keep and send
+//Only straight moves fit, diagonals are stored as two straight moves around whichever corner is open
+class Path
+{
+public:
+	class Iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Node::Direction value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Node::Direction *pointer;
+		typedef Node::Direction reference;
+
+		Iterator(const Path *path, size_t index) : _path(path), _index(index) {}
+
+		Node::Direction operator*() const { return (*_path)[_index]; }
+		Iterator &operator++() { _index++; return *this; }
+		Iterator operator++(int) { Iterator tmp = *this; _index++; return tmp; }
+
+		bool operator==(const Iterator &other) const { return _index == other._index; }
+		bool operator!=(const Iterator &other) const { return _index != other._index; }
+
+	private:
+		const Path *_path;
+		size_t _index;
+	};
+
+	Path(int startX = -1, int startY = -1);
+
+	//Empties the path and moves its start, the memory is kept for the next path
+	void clear(int startX, int startY);
+
+	//Adds a move to the end, false if it isn't a single straight move
+	bool push(Node::Direction move);
+
+	//Turns the path around so it runs from its end back to its start
+	void reverse();
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	Node::Direction operator[](size_t i) const;
+
+	Iterator begin() const { return Iterator(this, 0); }
+	Iterator end() const { return Iterator(this, _size); }
+
+	int getStartX() const { return _startX; }
+	int getStartY() const { return _startY; }
+	int getEndX() const { return _endX; }
+	int getEndY() const { return _endY; }
+
+	//Every cell along the path in order, start and end included
+	void getCells(std::vector<glm::vec2> &output) const;
+
+	//Moves packed four to a byte, lowest bits first, in the order north, south, east, west
+	const std::vector<unsigned char> &getData() const { return _data; }
+	//Replaces the path with packed moves, false if there aren't enough bytes for the count
+	bool setData(int startX, int startY, size_t count, const unsigned char *data, size_t bytes);
+
+private:
+	int _startX;
+	int _startY;
+	int _endX;
+	int _endY;
+
+	size_t _size = 0;
+	std::vector<unsigned char> _data;
+};
+
+#endif
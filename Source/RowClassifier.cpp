@@ -0,0 +1,136 @@
+#include "RowClassifier.h"
+
+#include <algorithm>
+
+//x64 always has SSE2, MSVC just doesn't say so
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#define WIDE_CLASSIFY
+#include <immintrin.h>
+#endif
+
+#include "Maze.h"
+
+static int countBits(unsigned int bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcount(bits);
+#else
+	int count = 0;
+	for (; bits != 0; bits &= bits - 1) count++;
+	return count;
+#endif
+}
+
+//Checks one character at a time from first, for the end of a row and to find exactly where an invalid character is
+static void classifyScalar(const char *row, int first, int length, RowClasses &classes)
+{
+	for (int i = first; i < length; i++)
+	{
+		char cell = row[i];
+
+		if (cell >= '1' && cell <= '9') classes.maxWeight = std::max(classes.maxWeight, cell - '0');
+		else if (cell == Node::Type::START) classes.starts++;
+		else if (cell == Node::Type::TARGET) classes.targets++;
+		else if (cell != Node::Type::WALL && cell != Node::Type::UNSEARCHED && cell != Node::Type::SEARCHED && cell != Node::Type::TRACED)
+		{
+			classes.invalid = i;
+			return;
+		}
+	}
+}
+
+#if defined(__AVX2__)
+struct Wide
+{
+	typedef __m256i Vector;
+	static const int width = 32;
+
+	static Vector load(const char *text) { return _mm256_loadu_si256((const __m256i *)text); }
+	static Vector set(char value) { return _mm256_set1_epi8(value); }
+	static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+	static Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+	static Vector both(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+	static Vector subtract(Vector a, Vector b) { return _mm256_sub_epi8(a, b); }
+	static Vector minimum(Vector a, Vector b) { return _mm256_min_epu8(a, b); }
+	static Vector maximum(Vector a, Vector b) { return _mm256_max_epu8(a, b); }
+	static unsigned int mask(Vector a) { return (unsigned int)_mm256_movemask_epi8(a); }
+	static void store(unsigned char *out, Vector a) { _mm256_storeu_si256((__m256i *)out, a); }
+};
+#elif defined(WIDE_CLASSIFY)
+struct Wide
+{
+	typedef __m128i Vector;
+	static const int width = 16;
+
+	static Vector load(const char *text) { return _mm_loadu_si128((const __m128i *)text); }
+	static Vector set(char value) { return _mm_set1_epi8(value); }
+	static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+	static Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+	static Vector both(Vector a, Vector b) { return _mm_and_si128(a, b); }
+	static Vector subtract(Vector a, Vector b) { return _mm_sub_epi8(a, b); }
+	static Vector minimum(Vector a, Vector b) { return _mm_min_epu8(a, b); }
+	static Vector maximum(Vector a, Vector b) { return _mm_max_epu8(a, b); }
+	static unsigned int mask(Vector a) { return (unsigned int)_mm_movemask_epi8(a); }
+	static void store(unsigned char *out, Vector a) { _mm_storeu_si128((__m128i *)out, a); }
+};
+#endif
+
+RowClasses classifyRow(const char *row, int length)
+{
+	RowClasses classes;
+	int i = 0;
+
+#ifdef WIDE_CLASSIFY
+	typedef Wide::Vector Vector;
+
+	const Vector wall = Wide::set(Node::Type::WALL);
+	const Vector open = Wide::set(Node::Type::UNSEARCHED);
+	const Vector start = Wide::set(Node::Type::START);
+	const Vector target = Wide::set(Node::Type::TARGET);
+	const Vector searched = Wide::set(Node::Type::SEARCHED);
+	const Vector traced = Wide::set(Node::Type::TRACED);
+	const Vector one = Wide::set('1');
+	const Vector eight = Wide::set(8);
+
+	//Largest digit character seen in each lane, 0 where there were none
+	Vector digits = Wide::set(0);
+
+	for (; i + Wide::width <= length; i += Wide::width)
+	{
+		Vector cells = Wide::load(row + i);
+
+		Vector starts = Wide::equal(cells, start);
+		Vector targets = Wide::equal(cells, target);
+
+		//Subtracting '1' wraps everything below it around to large values, so only '1' to '9' end up 8 or less
+		Vector offset = Wide::subtract(cells, one);
+		Vector weights = Wide::equal(Wide::minimum(offset, eight), offset);
+
+		Vector valid = Wide::either(Wide::either(starts, targets), weights);
+		valid = Wide::either(valid, Wide::either(Wide::equal(cells, wall), Wide::equal(cells, open)));
+		valid = Wide::either(valid, Wide::either(Wide::equal(cells, searched), Wide::equal(cells, traced)));
+
+		//Leave the block to the scalar check, which finds the exact column
+		if (Wide::mask(valid) != (unsigned int)((1ULL << Wide::width) - 1)) break;
+
+		//Starts and targets are rare, so most blocks skip the counting
+		unsigned int startBits = Wide::mask(starts);
+		unsigned int targetBits = Wide::mask(targets);
+		if ((startBits | targetBits) != 0)
+		{
+			classes.starts += countBits(startBits);
+			classes.targets += countBits(targetBits);
+		}
+		digits = Wide::maximum(digits, Wide::both(cells, weights));
+	}
+
+	unsigned char lanes[Wide::width];
+	Wide::store(lanes, digits);
+	unsigned char largest = *std::max_element(lanes, lanes + Wide::width);
+	if (largest != 0) classes.maxWeight = largest - '0';
+#endif
+
+	classifyScalar(row, i, length, classes);
+
+	return classes;
+}
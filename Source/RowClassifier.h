@@ -0,0 +1,20 @@
+#ifndef ROW_CLASSIFIER_H
+#define ROW_CLASSIFIER_H
+
+//What a row of a maze file holds, found by checking 32 or 16 characters at a time where AVX2 or SSE2 is available
+struct RowClasses
+{
+	long long starts = 0;
+	long long targets = 0;
+
+	//Highest weight digit in the row, 1 if there are none
+	int maxWeight = 1;
+
+	//Column of the first character that can't be part of a maze, -1 if every one can
+	int invalid = -1;
+};
+
+//Valid characters are the cell types a maze is written with and the weights 1-9
+RowClasses classifyRow(const char *row, int length);
+
+#endif
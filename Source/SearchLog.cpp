@@ -0,0 +1,365 @@
+#include "SearchLog.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "SolveCache.h"
+
+//Identifies log files and the version of their layout
+const char logMagic[4] = { 'M', 'Z', 'L', 'G' };
+const unsigned char logVersion = 3;
+
+//How many waiting cells are tried as the next anchor before falling back to a jump
+const size_t anchorWindow = 32;
+//Cells that have waited this long can't be an anchor any more, which keeps the waiting list bounded
+const size_t waitingLimit = 1 << 16;
+
+SearchLog::SearchLog()
+{
+}
+
+void SearchLog::begin(const Maze &maze)
+{
+	_xSize = maze.getX();
+	_ySize = maze.getY();
+	_mazeHash = SolveCache::hash(maze);
+
+	_searched.clear();
+	_traced.clear();
+
+	rewind();
+}
+
+void SearchLog::Stream::clear()
+{
+	data.clear();
+	count = 0;
+
+	rewind();
+}
+
+void SearchLog::Stream::rewind()
+{
+	bit = 0;
+	replayed = 0;
+	waiting.clear();
+	cursor = 0;
+	anchor = -1;
+	previous = 0;
+}
+
+void SearchLog::writeVarint(std::vector<unsigned char> &output, unsigned long long value)
+{
+	//Seven bits per byte, the high bit marks that more bytes follow
+	while (value >= 0x80)
+	{
+		output.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+
+	output.push_back((unsigned char)value);
+}
+
+bool SearchLog::readVarint(const std::vector<unsigned char> &input, size_t &pos, unsigned long long &value)
+{
+	value = 0;
+
+	for (int shift = 0; shift < 64 && pos < input.size(); shift += 7)
+	{
+		unsigned char byte = input[pos++];
+		value |= (unsigned long long)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0) return true;
+	}
+
+	return false;
+}
+
+void SearchLog::writeBits(Stream &stream, unsigned long long value, int count)
+{
+	//Lowest bit first, filling each byte from its lowest bit
+	for (int i = 0; i < count; i++, stream.bit++)
+	{
+		if (stream.bit % 8 == 0) stream.data.push_back(0);
+		if ((value >> i) & 1) stream.data.back() |= (unsigned char)(1 << (stream.bit % 8));
+	}
+}
+
+bool SearchLog::readBits(Stream &stream, int count, unsigned long long &value)
+{
+	value = 0;
+
+	for (int i = 0; i < count; i++, stream.bit++)
+	{
+		if (stream.bit >= stream.data.size() * 8) return false;
+		if ((stream.data[stream.bit / 8] >> (stream.bit % 8)) & 1) value |= 1ULL << i;
+	}
+
+	return true;
+}
+
+void SearchLog::logged(Stream &stream, long long index)
+{
+	stream.waiting.push_back(index);
+	stream.previous = index;
+
+	if (stream.waiting.size() - stream.cursor > waitingLimit) stream.cursor = stream.waiting.size() - waitingLimit;
+
+	//Drop the cells already passed once they are most of the list
+	if (stream.cursor > 4096 && stream.cursor * 2 > stream.waiting.size())
+	{
+		stream.waiting.erase(stream.waiting.begin(), stream.waiting.begin() + stream.cursor);
+		stream.cursor = 0;
+	}
+}
+
+void SearchLog::add(Stream &stream, long long index) const
+{
+	//The four moves, in the order they are numbered
+	const long long moves[4] = { -1, 1, _ySize, -(long long)_ySize };
+	auto moveFrom = [&](long long from)
+	{
+		for (int move = 0; from >= 0 && move < 4; move++)
+		{
+			if (from + moves[move] == index) return move;
+		}
+
+		return -1;
+	};
+
+	//0 and a move from the anchor, which is how a cell's neighbours after the first are searched
+	int move = moveFrom(stream.anchor);
+	if (move >= 0)
+	{
+		writeBits(stream, 0, 1);
+		writeBits(stream, move, 2);
+	}
+	else
+	{
+		//Otherwise the next anchor is usually the next waiting cell, as searches expand cells in the order they reach them
+		size_t available = std::min(stream.waiting.size() - stream.cursor, anchorWindow);
+		size_t skip = 1;
+		for (; skip <= available; skip++)
+		{
+			if ((move = moveFrom(stream.waiting[stream.cursor + skip - 1])) >= 0) break;
+		}
+
+		if (move >= 0)
+		{
+			//1, 0, how far along the waiting cells the anchor is as an Elias gamma code, then the move
+			int length = 0;
+			while ((skip >> (length + 1)) != 0) length++;
+
+			writeBits(stream, 1, 2);
+			writeBits(stream, 0, length);
+			writeBits(stream, 1, 1);
+			writeBits(stream, skip, length);
+			writeBits(stream, move, 2);
+
+			stream.anchor = stream.waiting[stream.cursor + skip - 1];
+			stream.cursor += skip;
+		}
+		else
+		{
+			//1, 1, then the zigzag encoded jump from the previous cell as a varint, the anchor stays where it is
+			long long delta = index - stream.previous;
+			unsigned long long value = ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63);
+
+			writeBits(stream, 3, 2);
+			for (; value >= 0x80; value >>= 7) writeBits(stream, (value & 0x7F) | 0x80, 8);
+			writeBits(stream, value, 8);
+		}
+	}
+
+	logged(stream, index);
+	stream.count++;
+}
+
+bool SearchLog::next(Stream &stream, long long &index) const
+{
+	if (stream.replayed >= stream.count) return false;
+
+	const long long moves[4] = { -1, 1, _ySize, -(long long)_ySize };
+	unsigned long long value;
+
+	if (!readBits(stream, 1, value)) return false;
+
+	if (value == 0)
+	{
+		if (stream.anchor < 0 || !readBits(stream, 2, value)) return false;
+		index = stream.anchor + moves[value];
+	}
+	else
+	{
+		if (!readBits(stream, 1, value)) return false;
+
+		if (value == 0)
+		{
+			int length = 0;
+			for (; readBits(stream, 1, value) && value == 0; length++)
+			{
+				if (length > 32) return false;
+			}
+
+			unsigned long long skip;
+			if (value == 0 || !readBits(stream, length, skip)) return false;
+			skip |= 1ULL << length;
+
+			if (skip > stream.waiting.size() - stream.cursor || !readBits(stream, 2, value)) return false;
+
+			stream.anchor = stream.waiting[stream.cursor + skip - 1];
+			stream.cursor += skip;
+			index = stream.anchor + moves[value];
+		}
+		else
+		{
+			unsigned long long delta = 0;
+			for (int shift = 0; ; shift += 7)
+			{
+				if (shift >= 64 || !readBits(stream, 8, value)) return false;
+				delta |= (value & 0x7F) << shift;
+
+				if ((value & 0x80) == 0) break;
+			}
+
+			index = (long long)((unsigned long long)stream.previous + ((delta >> 1) ^ -(delta & 1)));
+		}
+	}
+
+	logged(stream, index);
+	stream.replayed++;
+
+	return true;
+}
+
+void SearchLog::addSearched(int x, int y)
+{
+	add(_searched, (long long)x * _ySize + y);
+}
+
+void SearchLog::addTraced(int x, int y)
+{
+	add(_traced, (long long)x * _ySize + y);
+}
+
+bool SearchLog::save(const std::string &path) const
+{
+	std::ofstream output(path, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cout << "Could not open search log at: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> header(logMagic, logMagic + 4);
+	header.push_back(logVersion);
+	writeVarint(header, _xSize);
+	writeVarint(header, _ySize);
+	writeVarint(header, _mazeHash);
+	writeVarint(header, _searched.count);
+	writeVarint(header, _searched.data.size());
+	writeVarint(header, _traced.count);
+	writeVarint(header, _traced.data.size());
+
+	output.write((const char*)header.data(), header.size());
+	output.write((const char*)_searched.data.data(), _searched.data.size());
+	output.write((const char*)_traced.data.data(), _traced.data.size());
+
+	return output.good();
+}
+
+bool SearchLog::load(const std::string &path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input.is_open())
+	{
+		std::cout << "Could not open search log at: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	size_t pos = 5;
+	//Width, height, maze hash, then the count and byte size of the searched and traced cells, every cell takes at least 3 bits
+	unsigned long long values[7];
+	bool valid = data.size() >= pos && std::equal(logMagic, logMagic + 4, data.begin()) && data[4] == logVersion;
+	for (int i = 0; i < 7 && valid; i++)
+	{
+		valid = readVarint(data, pos, values[i]);
+	}
+
+	if (!valid || values[0] == 0 || values[1] == 0 || values[0] > 0x7FFFFFFF || values[1] > 0x7FFFFFFF || values[4] > data.size() || values[3] > values[4] * 8 / 3 || values[6] > data.size() || values[5] > values[6] * 8 / 3 || pos + values[4] + values[6] != data.size())
+	{
+		std::cout << "Search log at " << path << " is damaged or not a search log." << std::endl;
+		return false;
+	}
+
+	_xSize = (int)values[0];
+	_ySize = (int)values[1];
+	_mazeHash = values[2];
+	_searched.data.assign(data.begin() + pos, data.begin() + pos + values[4]);
+	_searched.count = values[3];
+	_traced.data.assign(data.begin() + pos + values[4], data.end());
+	_traced.count = values[5];
+	rewind();
+
+	return true;
+}
+
+void SearchLog::rewind()
+{
+	_searched.rewind();
+	_traced.rewind();
+	_replayTracing = false;
+	_replayChecked = false;
+}
+
+bool SearchLog::step(Maze &maze)
+{
+	glm::vec2 updatePos;
+	return step(maze, updatePos);
+}
+
+bool SearchLog::step(Maze &maze, glm::vec2 &updatePos)
+{
+	if (maze.getX() != _xSize || maze.getY() != _ySize)
+	{
+		std::cout << "Search log was recorded on a " << _xSize << "x" << _ySize << " maze and can't be replayed on this one." << std::endl;
+		return false;
+	}
+
+	//Hashing reads the whole maze, so it is only checked before the first change
+	if (!_replayChecked)
+	{
+		if (SolveCache::hash(maze) != _mazeHash)
+		{
+			std::cout << "Search log was recorded on a different maze and can't be replayed on this one." << std::endl;
+			return false;
+		}
+
+		_replayChecked = true;
+	}
+
+	//Move on to the traced path once every searched cell has been replayed
+	if (!_replayTracing && _searched.replayed >= _searched.count) _replayTracing = true;
+
+	long long index;
+	if (!next(_replayTracing ? _traced : _searched, index)) return false;
+
+	if (index < 0 || index >= (long long)_xSize * _ySize)
+	{
+		std::cout << "Search log is damaged, it names a cell outside the maze." << std::endl;
+		return false;
+	}
+
+	int x = (int)(index / _ySize);
+	int y = (int)(index % _ySize);
+	updatePos = glm::vec2(x, y);
+
+	//Start and target keep their marks just like in a real solve
+	Node::Type type = maze.getType(x, y);
+	if (!_replayTracing && type == Node::Type::UNSEARCHED) maze.setType(x, y, Node::Type::SEARCHED);
+	else if (_replayTracing && type == Node::Type::SEARCHED) maze.setType(x, y, Node::Type::TRACED);
+
+	return true;
+}
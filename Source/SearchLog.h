@@ -0,0 +1,93 @@
+#ifndef SEARCH_LOG_H
+#define SEARCH_LOG_H
+
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "Maze.h"
+
+//Records the order a solve searches cells and the path it traces so it can be replayed without solving again
+//Each cell is stored as a 2 bit move from a cell logged before it, usually the one it was searched or traced from,
+//which takes 3 to 7 bits, a cell with no logged neighbour to move from falls back to a varint jump from the last cell
+class SearchLog
+{
+public:
+	SearchLog();
+
+	//Starts a new recording of the maze, remembering its size and a hash of its contents
+	void begin(const Maze &maze);
+
+	void addSearched(int x, int y);
+	void addTraced(int x, int y);
+
+	int getX() const { return _xSize; }
+	int getY() const { return _ySize; }
+
+	long long getSearchedCount() const { return _searched.count; }
+	long long getTracedCount() const { return _traced.count; }
+	long long getEventCount() const { return _searched.count + _traced.count; }
+
+	bool save(const std::string &path) const;
+	bool load(const std::string &path);
+
+	//Replays the next recorded change onto the maze, searched cells first and then the traced path
+	//Returns false once every change has been applied, or with an error if the maze isn't the recorded one or the log is damaged
+	bool step(Maze &maze);
+	bool step(Maze &maze, glm::vec2 &updatePos);
+
+	void rewind();
+
+private:
+	//Cells of one kind as a stream of bits, with the state shared by writing and replaying it
+	struct Stream
+	{
+		std::vector<unsigned char> data;
+		long long count = 0;
+
+		//Bits written so far, or the next bit to read when replaying, and the cells replayed
+		size_t bit = 0;
+		long long replayed = 0;
+
+		//Cells logged but not yet moved from, in order from cursor on, earlier ones are dropped now and then
+		std::vector<long long> waiting;
+		size_t cursor = 0;
+
+		//Cell the last move was made from, and the last cell logged
+		long long anchor = -1;
+		long long previous = 0;
+
+		//Forgets the data and starts recording again
+		void clear();
+		//Keeps the data and goes back to its first cell to replay it
+		void rewind();
+	};
+
+	static void writeVarint(std::vector<unsigned char> &output, unsigned long long value);
+	static bool readVarint(const std::vector<unsigned char> &input, size_t &pos, unsigned long long &value);
+
+	static void writeBits(Stream &stream, unsigned long long value, int count);
+	static bool readBits(Stream &stream, int count, unsigned long long &value);
+
+	//Appends a cell, as a move from the anchor, a move from a waiting cell or a jump from the previous cell
+	void add(Stream &stream, long long index) const;
+	//Reads the next cell, false at the end of the stream or if it is damaged
+	bool next(Stream &stream, long long &index) const;
+	//Marks index as logged, so later cells can move from it
+	static void logged(Stream &stream, long long index);
+
+	int _xSize = 0;
+	int _ySize = 0;
+	//SolveCache::hash of the recorded maze, so a replay onto a different maze of the same size is caught
+	unsigned long long _mazeHash = 0;
+
+	Stream _searched;
+	Stream _traced;
+
+	//Replay state
+	bool _replayTracing = false;
+	bool _replayChecked = false;
+};
+
+#endif
@@ -0,0 +1,727 @@
+#include "Server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "Path.h"
+
+//Latencies kept for the percentiles, older ones are overwritten
+static const size_t LATENCY_HISTORY = 4096;
+
+//Bytes of replies a client can leave unread before it is disconnected
+static const size_t OUTBOX_LIMIT = 16 << 20;
+
+//How long shutting down waits for clients to read their last replies
+static const int SHUTDOWN_FLUSH_MS = 2000;
+
+#ifndef _WIN32
+//Linux can stop a send to a closed socket raising SIGPIPE, elsewhere each socket or the process is set up not to
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL | MSG_DONTWAIT;
+#else
+static const int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+#endif
+
+Server::Connection::~Connection()
+{
+#ifndef _WIN32
+	close(fd);
+#endif
+}
+
+Server::Server(const std::string &socketPath, int workers, long long maxCells) : _socketPath(socketPath), _workerCount(workers), _maxCells(maxCells), _running(false)
+{
+	//Cells are indexed with int inside the maze
+	_maxCells = std::max(9LL, std::min(_maxCells, (long long)std::numeric_limits<int>::max() / 2));
+	if (_workerCount <= 0) _workerCount = std::max(1u, std::thread::hardware_concurrency());
+	_latencies.reserve(LATENCY_HISTORY);
+}
+
+static bool parseInt(const std::string &word, int &value)
+{
+	char *end = nullptr;
+	long parsed = std::strtol(word.c_str(), &end, 10);
+	if (word.empty() || *end != '\0' || parsed < -2147483647L || parsed > 2147483647L) return false;
+
+	value = (int)parsed;
+	return true;
+}
+
+static char moveLetter(Node::Direction direction)
+{
+	switch (direction)
+	{
+	case Node::Direction::NORTH: return 'N';
+	case Node::Direction::SOUTH: return 'S';
+	case Node::Direction::EAST: return 'E';
+	default: return 'W';
+	}
+}
+
+//Cheapest cost from one cell to another, Dijkstra over a ring of buckets that stops once the second cell is settled
+//Costs are kept in the maze's workspace and only the cells reached are put back, so a short route stays cheap on a large maze
+static int exactCost(Maze &maze, int x1, int y1, int x2, int y2)
+{
+	if (maze.getType(x1, y1) == Node::Type::WALL || maze.getType(x2, y2) == Node::Type::WALL) return -1;
+
+	int xSize = maze.getX();
+	int ySize = maze.getY();
+
+	SolverWorkspace &ws = maze.getWorkspace();
+	size_t count = (size_t)xSize * ySize;
+	if (ws.costs.size() < count) ws.costs.resize(count, -1);
+
+	//The buckets are shared with the stepping search, which starts over once another search has used them
+	ws.owner = nullptr;
+	ws.queued = 0;
+
+	//Weights are single digits, so queued costs never span more than 10 buckets
+	const int bucketCount = 10;
+	if (ws.buckets.size() < (size_t)bucketCount) ws.buckets.resize(bucketCount);
+	for (std::vector<int> &bucket : ws.buckets)
+	{
+		bucket.clear();
+	}
+
+	std::vector<int> &reached = ws.frontier;
+	reached.clear();
+
+	int start = x1 * ySize + y1;
+	int target = x2 * ySize + y2;
+	ws.costs[start] = 0;
+	reached.push_back(start);
+	ws.buckets[0].push_back(start);
+	long long queued = 1;
+
+	const int moves[4][2] = { { 0, -1 }, { 0, 1 }, { 1, 0 }, { -1, 0 } };
+
+	int result = -1;
+	for (int cost = 0; queued > 0 && result == -1; cost++)
+	{
+		std::vector<int> &bucket = ws.buckets[cost % bucketCount];
+		while (!bucket.empty())
+		{
+			int cell = bucket.back();
+			bucket.pop_back();
+			queued--;
+
+			//Cheaper routes leave the old entry behind
+			if (ws.costs[cell] != cost) continue;
+
+			if (cell == target)
+			{
+				result = cost;
+				break;
+			}
+
+			int x = cell / ySize;
+			int y = cell % ySize;
+			for (const int *move : moves)
+			{
+				int nextX = x + move[0];
+				int nextY = y + move[1];
+				if (nextX < 0 || nextX >= xSize || nextY < 0 || nextY >= ySize || maze.getType(nextX, nextY) == Node::Type::WALL) continue;
+
+				int next = nextX * ySize + nextY;
+				int nextCost = cost + maze.getWeight(nextX, nextY);
+
+				int &known = ws.costs[next];
+				if (known != -1 && known <= nextCost) continue;
+				if (known == -1) reached.push_back(next);
+
+				known = nextCost;
+				ws.buckets[nextCost % bucketCount].push_back(next);
+				queued++;
+			}
+		}
+	}
+
+	for (int cell : reached)
+	{
+		ws.costs[cell] = -1;
+	}
+	for (std::vector<int> &bucket : ws.buckets)
+	{
+		bucket.clear();
+	}
+	reached.clear();
+	ws.track();
+
+	return result;
+}
+
+bool Server::run()
+{
+#ifdef _WIN32
+	std::cout << "The server needs Unix domain sockets, which this build doesn't support." << std::endl;
+	return false;
+#else
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (_socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cout << "Socket path is too long: " << _socketPath << std::endl;
+		return false;
+	}
+	std::copy(_socketPath.begin(), _socketPath.end(), address.sun_path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+	{
+		std::cout << "Could not create a socket." << std::endl;
+		return false;
+	}
+
+	//A socket file left behind by a server that didn't shut down cleanly would stop bind
+	unlink(_socketPath.c_str());
+	if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+	{
+		std::cout << "Could not listen on socket at: " << _socketPath << std::endl;
+		close(listener);
+		return false;
+	}
+
+	if (pipe(_wake) != 0)
+	{
+		std::cout << "Could not create a pipe to wake the server." << std::endl;
+		close(listener);
+		return false;
+	}
+	fcntl(_wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(_wake[1], F_SETFL, O_NONBLOCK);
+
+#if !defined(MSG_NOSIGNAL) && !defined(SO_NOSIGPIPE)
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	std::cout << "Serving on " << _socketPath << " with " << _workerCount << " workers." << std::endl;
+
+	_running = true;
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < _workerCount; i++)
+	{
+		workers.push_back(std::thread(&Server::work, this));
+	}
+
+	//Every connection is read here, workers only ever write replies
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<std::string> buffers;
+	std::vector<pollfd> polled;
+	char chunk[4096];
+
+	while (_running)
+	{
+		polled.clear();
+		polled.push_back({ listener, POLLIN, 0 });
+		polled.push_back({ _wake[0], POLLIN, 0 });
+		for (const std::shared_ptr<Connection> &connection : connections)
+		{
+			std::lock_guard<std::mutex> lock(connection->writeLock);
+			short events = connection->reading ? POLLIN : 0;
+			if (!connection->outbox.empty()) events |= POLLOUT;
+			polled.push_back({ connection->fd, events, 0 });
+		}
+
+		//Times out now and then so stop is noticed without any traffic
+		if (poll(polled.data(), polled.size(), 100) <= 0) continue;
+
+		if (polled[1].revents & POLLIN)
+		{
+			while (read(_wake[0], chunk, sizeof(chunk)) > 0);
+		}
+
+		for (size_t i = polled.size() - 1; i > 1; i--)
+		{
+			size_t c = i - 2;
+
+			if (polled[i].revents & POLLOUT)
+			{
+				std::lock_guard<std::mutex> lock(connections[c]->writeLock);
+				flush(*connections[c]);
+			}
+
+			//A client that has finished sending is kept until every reply it asked for has been sent
+			if (!connections[c]->reading)
+			{
+				bool finished;
+				{
+					std::lock_guard<std::mutex> lock(connections[c]->writeLock);
+					if (polled[i].revents & (POLLHUP | POLLERR)) connections[c]->dropped = true;
+
+					//Queued requests hold the connection, so once nothing else does no more replies can come
+					finished = connections[c]->dropped || (connections[c]->outbox.empty() && connections[c].use_count() == 1);
+				}
+
+				if (finished)
+				{
+					connections.erase(connections.begin() + c);
+					buffers.erase(buffers.begin() + c);
+				}
+				continue;
+			}
+
+			if ((polled[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0) continue;
+
+			ssize_t received = recv(connections[c]->fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+			if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+			if (received <= 0)
+			{
+				shutdown(connections[c]->fd, SHUT_RD);
+				connections[c]->reading = false;
+
+				if (received < 0)
+				{
+					std::lock_guard<std::mutex> lock(connections[c]->writeLock);
+					connections[c]->dropped = true;
+				}
+				continue;
+			}
+
+			std::string &buffer = buffers[c];
+			buffer.append(chunk, received);
+
+			size_t lineStart = 0;
+			size_t lineEnd;
+			while ((lineEnd = buffer.find('\n', lineStart)) != std::string::npos)
+			{
+				std::string line = buffer.substr(lineStart, lineEnd - lineStart);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+
+				accept(connections[c], line);
+				lineStart = lineEnd + 1;
+			}
+			buffer.erase(0, lineStart);
+		}
+
+		if (polled[0].revents & POLLIN)
+		{
+			int fd = ::accept(listener, nullptr, nullptr);
+			if (fd >= 0)
+			{
+#ifdef SO_NOSIGPIPE
+				int on = 1;
+				setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+				connections.push_back(std::make_shared<Connection>(fd));
+				buffers.push_back(std::string());
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_queueLock);
+		_queueReady.notify_all();
+	}
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+
+	//Every queued request has its reply in an outbox now, give clients a little while to read them before closing
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SHUTDOWN_FLUSH_MS);
+	for (const std::shared_ptr<Connection> &connection : connections)
+	{
+		std::lock_guard<std::mutex> lock(connection->writeLock);
+		while (true)
+		{
+			flush(*connection);
+			if (connection->outbox.empty() || connection->dropped) break;
+
+			int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			pollfd writable = { connection->fd, POLLOUT, 0 };
+			if (remaining <= 0 || poll(&writable, 1, remaining) <= 0) break;
+		}
+	}
+
+	connections.clear();
+	close(_wake[0]);
+	close(_wake[1]);
+	close(listener);
+	unlink(_socketPath.c_str());
+
+	return true;
+#endif
+}
+
+void Server::stop()
+{
+	std::lock_guard<std::mutex> lock(_queueLock);
+	_running = false;
+	_queueReady.notify_all();
+}
+
+void Server::accept(const std::shared_ptr<Connection> &connection, const std::string &line)
+{
+	Request request;
+	request.connection = connection;
+	request.arrived = std::chrono::steady_clock::now();
+
+	std::istringstream words(line);
+	std::string word;
+	while (words >> word)
+	{
+		if (request.words.empty() && request.tag.empty() && word[0] == '#') request.tag = word;
+		else request.words.push_back(word);
+	}
+
+	if (request.words.empty()) return;
+
+	const std::string &command = request.words[0];
+	if (command == "STATS")
+	{
+		reply(request, formatStats());
+		return;
+	}
+
+	if (command == "SHUTDOWN")
+	{
+		reply(request, "OK");
+		stop();
+		return;
+	}
+
+	if (request.words.size() < 2)
+	{
+		reply(request, "ERR missing maze name");
+		return;
+	}
+
+	std::string name = request.words[1];
+	bool creates = command == "LOAD" || command == "GENERATE";
+
+	std::unique_lock<std::mutex> lock(_queueLock);
+
+	std::shared_ptr<Resident> &resident = _mazes[name];
+	if (!resident)
+	{
+		if (!creates)
+		{
+			_mazes.erase(name);
+			lock.unlock();
+			reply(request, "ERR no maze named " + name);
+			return;
+		}
+
+		resident = std::make_shared<Resident>();
+	}
+
+	resident->pending.push_back(std::move(request));
+	_queueDepth++;
+
+	//A maze already waiting for or held by a worker picks the request up with the rest of its batch
+	if (!resident->scheduled)
+	{
+		resident->scheduled = true;
+		_ready.push_back({ name, resident });
+		_queueReady.notify_one();
+	}
+
+	int depth = _queueDepth;
+	lock.unlock();
+
+	std::lock_guard<std::mutex> statsLock(_statsLock);
+	_maxQueueDepth = std::max(_maxQueueDepth, depth);
+}
+
+void Server::work()
+{
+	std::deque<Request> batch;
+
+	std::unique_lock<std::mutex> lock(_queueLock);
+	while (true)
+	{
+		_queueReady.wait(lock, [this]() { return !_running || !_ready.empty(); });
+		//Requests that arrived before stopping are still answered
+		if (_ready.empty()) return;
+
+		std::string name = _ready.front().first;
+		std::shared_ptr<Resident> resident = _ready.front().second;
+		_ready.pop_front();
+
+		//Take everything queued so far, the maze stays scheduled so no other worker can take it meanwhile
+		batch.swap(resident->pending);
+		_queueDepth -= (int)batch.size();
+		lock.unlock();
+
+		for (const Request &request : batch)
+		{
+			reply(request, handle(name, *resident, request));
+		}
+
+		{
+			std::lock_guard<std::mutex> statsLock(_statsLock);
+			_batches++;
+		}
+		batch.clear();
+
+		lock.lock();
+		if (resident->pending.empty()) resident->scheduled = false;
+		else _ready.push_back({ name, resident });
+	}
+}
+
+std::string Server::handle(const std::string &name, Resident &resident, const Request &request)
+{
+	const std::vector<std::string> &words = request.words;
+	const std::string &command = words[0];
+	Maze &maze = resident.maze;
+
+	if (command == "LOAD" || command == "GENERATE")
+	{
+		resident.solved = false;
+		resident.loaded = false;
+
+		std::string error;
+		try
+		{
+			error = create(maze, words);
+		}
+		catch (const std::bad_alloc &)
+		{
+			error = "ERR out of memory";
+		}
+
+		//The name is dropped, and anything already queued behind it is refused
+		if (!error.empty())
+		{
+			forget(name, resident);
+			return error;
+		}
+
+		resident.loaded = true;
+
+		return "OK " + std::to_string(maze.getX()) + " " + std::to_string(maze.getY());
+	}
+
+	if (command == "UNLOAD")
+	{
+		resident.loaded = false;
+		forget(name, resident);
+
+		return "OK";
+	}
+
+	if (!resident.loaded) return "ERR no maze named " + name;
+
+	if (command == "SOLVE")
+	{
+		if (words.size() != 2) return "ERR usage: SOLVE <name>";
+
+		//Later solves in a batch, and later batches, reuse the first one until the maze is replaced
+		if (!resident.solved)
+		{
+			maze.reset();
+			resident.steps = maze.process();
+			resident.solved = true;
+		}
+
+		if (resident.steps < 0) return "ERR no solution";
+		return "OK " + std::to_string(resident.steps);
+	}
+
+	if (command == "DISTANCE" || command == "PATH" || command == "EXACT")
+	{
+		int cells[4];
+		if (words.size() != 6) return "ERR usage: " + command + " <name> <x1> <y1> <x2> <y2>";
+		for (int i = 0; i < 4; i++)
+		{
+			if (!parseInt(words[i + 2], cells[i])) return "ERR usage: " + command + " <name> <x1> <y1> <x2> <y2>";
+
+			int size = i % 2 == 0 ? maze.getX() : maze.getY();
+			if (cells[i] < 0 || cells[i] >= size) return "ERR cell out of range";
+		}
+
+		if (command != "PATH")
+		{
+			int cost = command == "EXACT" ? exactCost(maze, cells[0], cells[1], cells[2], cells[3]) : resident.index.distance(cells[0], cells[1], cells[2], cells[3]);
+			if (cost < 0) return "ERR no route";
+			return "OK " + std::to_string(cost);
+		}
+
+		Path path;
+		int cost = resident.index.findPath(cells[0], cells[1], cells[2], cells[3], path);
+		if (cost < 0) return "ERR no route";
+
+		std::string text = "OK " + std::to_string(cost) + " ";
+		text.reserve(text.size() + path.size());
+		for (Node::Direction move : path)
+		{
+			text.push_back(moveLetter(move));
+		}
+
+		return text;
+	}
+
+	return "ERR unknown command " + command;
+}
+
+std::string Server::create(Maze &maze, const std::vector<std::string> &words)
+{
+	if (words[0] == "LOAD")
+	{
+		if (words.size() != 3) return "ERR usage: LOAD <name> <path>";
+
+		//Every row ends in a newline, so a file has at least half as many cells as bytes
+		std::error_code error;
+		unsigned long long bytes = std::filesystem::file_size(words[2], error);
+		if (!error && bytes / 2 > (unsigned long long)_maxCells) return "ERR maze is larger than " + std::to_string(_maxCells) + " cells";
+
+		if (!maze.load(words[2])) return "ERR could not load " + words[2];
+	}
+	else
+	{
+		int x;
+		int y;
+		if (words.size() != 4 || !parseInt(words[2], x) || !parseInt(words[3], y) || x < 3 || y < 3) return "ERR usage: GENERATE <name> <x> <y>";
+
+		//Sizes are rounded up to odd and get a wall border just as generate does, so nothing too large is ever allocated
+		long long generatedX = (long long)x + (x % 2 == 0 ? 1 : 0) + 2;
+		long long generatedY = (long long)y + (y % 2 == 0 ? 1 : 0) + 2;
+		if (generatedX * generatedY > _maxCells) return "ERR maze is larger than " + std::to_string(_maxCells) + " cells";
+
+		maze.generate(x, y);
+	}
+
+	if ((long long)maze.getX() * maze.getY() > _maxCells) return "ERR maze is larger than " + std::to_string(_maxCells) + " cells";
+
+	return "";
+}
+
+void Server::forget(const std::string &name, const Resident &resident)
+{
+	std::lock_guard<std::mutex> lock(_queueLock);
+
+	//The name may already belong to a maze loaded since
+	auto found = _mazes.find(name);
+	if (found != _mazes.end() && found->second.get() == &resident) _mazes.erase(found);
+}
+
+void Server::reply(const Request &request, const std::string &text)
+{
+	std::string line = request.tag.empty() ? text : request.tag + " " + text;
+	line.push_back('\n');
+
+#ifndef _WIN32
+	Connection &connection = *request.connection;
+	bool waiting = false;
+	{
+		std::lock_guard<std::mutex> lock(connection.writeLock);
+
+		//A client that has gone away or stopped reading only loses its own replies
+		if (!connection.dropped)
+		{
+			connection.outbox += line;
+			flush(connection);
+
+			if (connection.outbox.size() > OUTBOX_LIMIT)
+			{
+				connection.dropped = true;
+				connection.outbox.clear();
+				shutdown(connection.fd, SHUT_RDWR);
+			}
+
+			waiting = !connection.outbox.empty();
+		}
+	}
+
+	if (waiting)
+	{
+		//A full pipe already has a wake pending, so a failed write needs no handling
+		char wake = 0;
+		ssize_t written = write(_wake[1], &wake, 1);
+		(void)written;
+	}
+#endif
+
+	double latency = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - request.arrived).count();
+
+	std::lock_guard<std::mutex> lock(_statsLock);
+	_requests++;
+	if (_latencies.size() < LATENCY_HISTORY) _latencies.push_back(latency);
+	else _latencies[_latencyNext] = latency;
+	_latencyNext = (_latencyNext + 1) % LATENCY_HISTORY;
+}
+
+void Server::flush(Connection &connection)
+{
+#ifndef _WIN32
+	size_t sent = 0;
+	while (sent < connection.outbox.size())
+	{
+		ssize_t written = send(connection.fd, connection.outbox.data() + sent, connection.outbox.size() - sent, SEND_FLAGS);
+		if (written <= 0)
+		{
+			//Anything other than a full socket means the client is gone
+			if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) connection.dropped = true;
+			break;
+		}
+		sent += written;
+	}
+
+	if (connection.dropped) connection.outbox.clear();
+	else connection.outbox.erase(0, sent);
+#endif
+}
+
+Server::Stats Server::getStats() const
+{
+	Stats stats;
+	std::vector<double> latencies;
+
+	{
+		std::lock_guard<std::mutex> lock(_statsLock);
+		stats.requests = _requests;
+		stats.batches = _batches;
+		stats.maxQueueDepth = _maxQueueDepth;
+		latencies = _latencies;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_queueLock);
+		stats.queueDepth = _queueDepth;
+		stats.mazes = (int)_mazes.size();
+	}
+
+	if (!latencies.empty())
+	{
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+
+		stats.p50 = percentile(0.5);
+		stats.p90 = percentile(0.9);
+		stats.p99 = percentile(0.99);
+		stats.max = latencies.back();
+	}
+
+	return stats;
+}
+
+std::string Server::formatStats() const
+{
+	Stats stats = getStats();
+
+	std::ostringstream text;
+	text << "OK requests=" << stats.requests << " batches=" << stats.batches << " queue=" << stats.queueDepth << " max_queue=" << stats.maxQueueDepth << " mazes=" << stats.mazes;
+	text << " p50_us=" << (long long)stats.p50 << " p90_us=" << (long long)stats.p90 << " p99_us=" << (long long)stats.p99 << " max_us=" << (long long)stats.max;
+
+	return text.str();
+}
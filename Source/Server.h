@@ -0,0 +1,147 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "HierarchicalIndex.h"
+#include "Maze.h"
+
+//Keeps mazes loaded between requests and answers queries about them over a Unix domain socket
+//Requests are single lines of words and every request gets a single line reply starting with OK or ERR:
+//  LOAD <name> <path>                      load a maze file and keep it as name
+//  GENERATE <name> <x> <y>                 generate a maze and keep it as name
+//  UNLOAD <name>                           forget a maze
+//  SOLVE <name>                            steps from the maze's starts to its nearest target
+//  DISTANCE <name> <x1> <y1> <x2> <y2>     cost of a route between two cells from the hierarchical index
+//  PATH <name> <x1> <y1> <x2> <y2>         the same cost followed by the route as a string of N, S, E and W
+//  EXACT <name> <x1> <y1> <x2> <y2>        cost of the cheapest route, searching outward from the first cell until it reaches the second
+//  STATS                                   request counts, queue depth and latency percentiles
+//  SHUTDOWN                                stop the server
+//DISTANCE and PATH are approximate: they are shortest on mazes of one cell wide corridors, but can be a little
+//longer than the cheapest route through open areas or weighted cells, EXACT is slower but always the cheapest
+//A request may start with #<tag>, the reply then starts with the same tag, which matters for clients that
+//send several requests at once as replies about different mazes can come back in any order
+//Requests about the same maze are answered in order, and any that queue up are handled together in one batch
+class Server
+{
+public:
+	struct Stats
+	{
+		long long requests = 0;
+		long long batches = 0;
+		int queueDepth = 0;
+		int maxQueueDepth = 0;
+		int mazes = 0;
+
+		//Microseconds from a request arriving to its reply being sent, over the most recent requests
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	//0 workers uses one per hardware thread, mazes with more than maxCells cells are refused
+	Server(const std::string &socketPath, int workers = 0, long long maxCells = 100000000);
+
+	//Serves until stop is called or a client sends SHUTDOWN, answering whatever is already queued, false if the socket couldn't be opened
+	bool run();
+	void stop();
+
+	Stats getStats() const;
+
+private:
+	struct Connection
+	{
+		Connection(int fd) : fd(fd) {}
+		~Connection();
+
+		int fd;
+
+		//Replies waiting for the client to read, sent without blocking and flushed by the poll loop
+		//Guarded by writeLock, so replies from different workers never interleave
+		std::mutex writeLock;
+		std::string outbox;
+		//Set once a client falls too far behind, nothing more is sent to it
+		bool dropped = false;
+
+		//Cleared once the client has nothing more to send, only used by the poll loop
+		bool reading = true;
+	};
+
+	struct Request
+	{
+		std::shared_ptr<Connection> connection;
+		std::string tag;
+		std::vector<std::string> words;
+		std::chrono::steady_clock::time_point arrived;
+	};
+
+	//A maze kept between requests, only one worker handles it at a time
+	struct Resident
+	{
+		Resident() : index(maze) {}
+
+		Maze maze;
+		HierarchicalIndex index;
+
+		bool loaded = false;
+
+		//The maze's own solve, worked out on the first SOLVE after each load
+		bool solved = false;
+		int steps = -1;
+
+		//Guarded by the queue lock
+		std::deque<Request> pending;
+		bool scheduled = false;
+	};
+
+	//Splits a line into words and queues it, or answers it straight away if no maze is involved
+	void accept(const std::shared_ptr<Connection> &connection, const std::string &line);
+
+	void work();
+	std::string handle(const std::string &name, Resident &resident, const Request &request);
+	//Loads or generates the maze for a LOAD or GENERATE request, the error to reply with if it fails
+	std::string create(Maze &maze, const std::vector<std::string> &words);
+	//Drops the name unless it has been given to another maze since
+	void forget(const std::string &name, const Resident &resident);
+
+	void reply(const Request &request, const std::string &text);
+	//Sends as much of the outbox as the socket takes without blocking, call with the write lock held
+	void flush(Connection &connection);
+
+	std::string formatStats() const;
+
+	std::string _socketPath;
+	int _workerCount;
+	long long _maxCells;
+
+	std::atomic<bool> _running;
+
+	//Workers write a byte here when a reply is left in an outbox, so the poll loop wakes to flush it
+	int _wake[2] = { -1, -1 };
+
+	//Mazes by name, the requests waiting on each and the mazes ready for a worker
+	mutable std::mutex _queueLock;
+	std::condition_variable _queueReady;
+	std::map<std::string, std::shared_ptr<Resident>> _mazes;
+	std::deque<std::pair<std::string, std::shared_ptr<Resident>>> _ready;
+	int _queueDepth = 0;
+
+	mutable std::mutex _statsLock;
+	long long _requests = 0;
+	long long _batches = 0;
+	int _maxQueueDepth = 0;
+	//Ring of the most recent latencies in microseconds
+	std::vector<double> _latencies;
+	size_t _latencyNext = 0;
+};
+
+#endif
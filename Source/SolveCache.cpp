@@ -0,0 +1,278 @@
+#include "SolveCache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+
+//Identifies cache entries and the version of their layout
+const char cacheMagic[4] = { 'M', 'Z', 'S', 'C' };
+const unsigned char cacheVersion = 2;
+//Seed of the second hash stored in each entry, which has to match as well as the key
+const unsigned long long checkSeed = 0x5EEDC4ECull;
+
+SolveCache::SolveCache(const std::string &directory, unsigned long long maxBytes) : _directory(directory), _maxBytes(maxBytes)
+{
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error) std::cout << "Could not create solve cache at: " << _directory << std::endl;
+}
+
+//Hashes the maze under each seed at once, so the key and its check cost a single pass over the cells
+static void hashSeeds(const Maze &maze, const unsigned long long *seeds, unsigned long long *results, int count)
+{
+	const unsigned long long prime = 0x9E3779B97F4A7C15ull;
+
+	for (int s = 0; s < count; s++)
+	{
+		results[s] = (((unsigned long long)maze.getX() << 32) ^ (unsigned long long)maze.getY()) + seeds[s] * prime;
+	}
+
+	unsigned long long word = 0;
+	int filled = 0;
+
+	TypeView view = maze.getView();
+	for (int i = 0; i < maze.getX(); i++)
+	{
+		int o = 0;
+		for (Node::Type type : view.column(i))
+		{
+			//Searched and traced cells are just open cells left over from an earlier solve
+			if (type == Node::Type::SEARCHED || type == Node::Type::TRACED) type = Node::Type::UNSEARCHED;
+
+			//Each cell gets 16 bits to itself, the type in the low byte and the weight above it
+			unsigned long long cell = type;
+			if (type == Node::Type::UNSEARCHED) cell |= (unsigned long long)maze.getWeight(i, o) << 8;
+			o++;
+
+			//Cells are packed a word at a time and mixed in with a multiply and shift
+			word = (word << 16) | cell;
+			if (++filled < 4) continue;
+
+			for (int s = 0; s < count; s++)
+			{
+				results[s] = (results[s] ^ word) * prime;
+				results[s] ^= results[s] >> 29;
+			}
+			word = 0;
+			filled = 0;
+		}
+	}
+
+	for (int s = 0; s < count; s++)
+	{
+		results[s] = (results[s] ^ word) * prime;
+		results[s] ^= results[s] >> 32;
+	}
+}
+
+unsigned long long SolveCache::hash(const Maze &maze, unsigned long long seed)
+{
+	unsigned long long result;
+	hashSeeds(maze, &seed, &result, 1);
+
+	return result;
+}
+
+std::string SolveCache::entryPath(unsigned long long key) const
+{
+	const char digits[] = "0123456789abcdef";
+
+	std::string name(16, '0');
+	for (int i = 15; i >= 0; i--)
+	{
+		name[i] = digits[key & 15];
+		key >>= 4;
+	}
+
+	return (std::filesystem::path(_directory) / (name + ".solve")).string();
+}
+
+bool SolveCache::read(unsigned long long key, Entry &entry) const
+{
+	std::ifstream input(entryPath(key), std::ios::binary);
+	if (!input.is_open()) return false;
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	//Magic, version, a second hash of the maze to confirm the key, then six 32 bit values: width, height, steps, start x, start y and move count
+	const size_t headerSize = 5 + 8 + 6 * 4;
+	if (data.size() < headerSize || !std::equal(cacheMagic, cacheMagic + 4, data.begin()) || data[4] != cacheVersion) return false;
+
+	entry.check = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		entry.check |= (unsigned long long)data[5 + i] << (i * 8);
+	}
+
+	int values[6];
+	for (int i = 0; i < 6; i++)
+	{
+		const unsigned char *bytes = &data[13 + i * 4];
+		values[i] = (int)((unsigned int)bytes[0] | (unsigned int)bytes[1] << 8 | (unsigned int)bytes[2] << 16 | (unsigned int)bytes[3] << 24);
+	}
+
+	size_t moveCount = (unsigned int)values[5];
+	if (data.size() != headerSize + (moveCount + 3) / 4) return false;
+
+	entry.xSize = values[0];
+	entry.ySize = values[1];
+	entry.steps = values[2];
+
+	//Moves are stored exactly as the path packs them
+	return entry.path.setData(values[3], values[4], moveCount, data.data() + headerSize, data.size() - headerSize);
+}
+
+void SolveCache::write(unsigned long long key, const Entry &entry)
+{
+	std::vector<unsigned char> data(cacheMagic, cacheMagic + 4);
+	data.push_back(cacheVersion);
+
+	for (int i = 0; i < 8; i++)
+	{
+		data.push_back((unsigned char)(entry.check >> (i * 8)));
+	}
+
+	int values[6] = { entry.xSize, entry.ySize, entry.steps, entry.path.getStartX(), entry.path.getStartY(), (int)entry.path.size() };
+	for (int value : values)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			data.push_back((unsigned char)((unsigned int)value >> (i * 8)));
+		}
+	}
+
+	data.insert(data.end(), entry.path.getData().begin(), entry.path.getData().end());
+
+	//Written to a temporary file first so a crash never leaves half an entry behind
+	std::string path = entryPath(key);
+	std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream output(tmpPath, std::ios::binary);
+		if (!output.is_open()) return;
+
+		output.write((const char*)data.data(), data.size());
+		if (!output.good()) return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	if (error) return;
+
+	//The directory is only listed again once the running total says it may be over the limit
+	//Replaced and removed entries aren't taken off the total, so it can only run high and trigger an early listing
+	_bytes += data.size();
+	if (!_counted || _bytes > _maxBytes) evict();
+}
+
+void SolveCache::evict()
+{
+	struct File
+	{
+		std::filesystem::path path;
+		std::filesystem::file_time_type used;
+		unsigned long long size;
+	};
+
+	std::vector<File> files;
+	unsigned long long total = 0;
+
+	std::error_code error;
+	for (const std::filesystem::directory_entry &item : std::filesystem::directory_iterator(_directory, error))
+	{
+		if (item.path().extension() != ".solve") continue;
+
+		File file = { item.path(), item.last_write_time(error), item.file_size(error) };
+		files.push_back(file);
+		total += file.size;
+	}
+
+	_bytes = total;
+	_counted = true;
+	if (total <= _maxBytes) return;
+
+	//Hits refresh the write time, so the oldest time is the least recently used entry
+	std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.used < b.used; });
+	for (const File &file : files)
+	{
+		if (total <= _maxBytes) break;
+
+		std::filesystem::remove(file.path, error);
+		total -= file.size;
+	}
+
+	_bytes = total;
+}
+
+bool SolveCache::matches(const Maze &maze, const Entry &entry, unsigned long long check)
+{
+	if (entry.xSize != maze.getX() || entry.ySize != maze.getY() || entry.check != check) return false;
+
+	//The check already covers every wall, start and target, so an unsolvable entry is taken at its word
+	if (entry.steps == -1) return entry.path.empty();
+	if (entry.steps < 0) return false;
+
+	int x = entry.path.getStartX();
+	int y = entry.path.getStartY();
+	if (x < 0 || y < 0 || x >= maze.getX() || y >= maze.getY() || maze.getType(x, y) != Node::Type::START) return false;
+
+	//Every move has to stay on open cells inside the maze, adding up to the cached cost
+	long long cost = 0;
+	for (Node::Direction move : entry.path)
+	{
+		if (move == Node::Direction::NORTH) y--;
+		else if (move == Node::Direction::SOUTH) y++;
+		else if (move == Node::Direction::EAST) x++;
+		else x--;
+
+		if (x < 0 || y < 0 || x >= maze.getX() || y >= maze.getY() || maze.getType(x, y) == Node::Type::WALL) return false;
+		cost += maze.getWeight(x, y);
+	}
+
+	return maze.getType(x, y) == Node::Type::TARGET && cost == entry.steps;
+}
+
+int SolveCache::solve(Maze &maze)
+{
+	const unsigned long long seeds[2] = { 0, checkSeed };
+	unsigned long long hashes[2];
+	hashSeeds(maze, seeds, hashes, 2);
+
+	unsigned long long key = hashes[0];
+	unsigned long long check = hashes[1];
+
+	Entry entry;
+	if (read(key, entry))
+	{
+		std::error_code error;
+
+		if (matches(maze, entry, check))
+		{
+			_hits++;
+
+			std::filesystem::last_write_time(entryPath(key), std::filesystem::file_time_type::clock::now(), error);
+
+			maze.reset();
+			if (entry.steps != -1) maze.applySolution(entry.path, entry.steps);
+
+			return entry.steps;
+		}
+
+		//A damaged entry, or another maze with the same key, is replaced by the solve below
+		std::filesystem::remove(entryPath(key), error);
+	}
+
+	_misses++;
+
+	maze.reset();
+	entry.xSize = maze.getX();
+	entry.ySize = maze.getY();
+	entry.check = check;
+	entry.steps = maze.process();
+
+	//The path is read out while tracing, so the grid is only walked once
+	maze.trace(entry.path);
+
+	write(key, entry);
+
+	return entry.steps;
+}
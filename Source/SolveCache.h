@@ -0,0 +1,61 @@
+#ifndef SOLVE_CACHE_H
+#define SOLVE_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "Maze.h"
+#include "Path.h"
+
+//Remembers solutions on disk keyed by a hash of the maze, so solving a maze seen before skips the search
+//Each entry is a small file holding the step count and the path at 2 bits per move
+//Entries are evicted least recently used first once the directory grows past its size limit
+class SolveCache
+{
+public:
+	SolveCache(const std::string &directory, unsigned long long maxBytes = 64ull << 20);
+
+	//Solves and traces the maze, reapplying the cached path instead of searching when there is one
+	int solve(Maze &maze);
+
+	//Hash of the walls, weights, starts and targets, ignoring any searched or traced marks
+	//Different seeds give independent hashes of the same maze
+	static unsigned long long hash(const Maze &maze, unsigned long long seed = 0);
+
+	unsigned long long getHits() const { return _hits; }
+	unsigned long long getMisses() const { return _misses; }
+
+private:
+	struct Entry
+	{
+		int xSize = 0;
+		int ySize = 0;
+		int steps = -1;
+		//Hash of the maze under a second seed, so a key collision is caught instead of applied
+		unsigned long long check = 0;
+		Path path;
+	};
+
+	std::string entryPath(unsigned long long key) const;
+
+	bool read(unsigned long long key, Entry &entry) const;
+	void write(unsigned long long key, const Entry &entry);
+
+	//True if the entry is for this maze, given its check hash, and its path is a real route from a start to a target at the cached cost
+	static bool matches(const Maze &maze, const Entry &entry, unsigned long long check);
+
+	//Removes the oldest entries until the directory fits in the size limit
+	void evict();
+
+	std::string _directory;
+	unsigned long long _maxBytes;
+
+	//Bytes in the directory as of the last listing plus everything written since
+	unsigned long long _bytes = 0;
+	bool _counted = false;
+
+	unsigned long long _hits = 0;
+	unsigned long long _misses = 0;
+};
+
+#endif
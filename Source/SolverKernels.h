@@ -0,0 +1,282 @@
+#ifndef SOLVER_KERNELS_H
+#define SOLVER_KERNELS_H
+
+#include <vector>
+
+#include "Maze.h"
+#include "SolverWorkspace.h"
+
+//Breadth first search kernels specialised at compile time so the inner loop has no runtime dispatch
+//A kernel is chosen by neighbourhood, when to stop and how the search state is laid out in memory
+namespace Kernels
+{
+	//Search state of a single cell as the kernels see it
+	enum State
+	{
+		OPEN = 0,
+		TARGET = 1,
+		WALL = 2,
+		//Cells that can't be entered but aren't walls, like starts
+		BLOCKED = 3,
+		//Searched cells keep their parent direction in the low bits
+		VISITED = 0x80
+	};
+
+	struct FourConnected
+	{
+		static const int count = 4;
+
+		int offsets[count];
+		Node::Direction parents[count];
+
+		FourConnected(int ySize)
+		{
+			//North, south, east, west, with the direction leading back to the current cell
+			const int dx[count] = { 0, 0, 1, -1 };
+			const int dy[count] = { -1, 1, 0, 0 };
+			const Node::Direction back[count] = { Node::Direction::SOUTH, Node::Direction::NORTH, Node::Direction::WEST, Node::Direction::EAST };
+
+			for (int i = 0; i < count; i++)
+			{
+				offsets[i] = dx[i] * ySize + dy[i];
+				parents[i] = back[i];
+			}
+		}
+
+		template <class Layout>
+		bool passable(const Layout & /*layout*/, int /*current*/, int /*neighbour*/) const
+		{
+			return true;
+		}
+	};
+
+	struct EightConnected
+	{
+		static const int count = 8;
+
+		int offsets[count];
+		Node::Direction parents[count];
+
+		//Diagonals can't squeeze between two walls, so the two cells beside each diagonal are checked
+		int sideA[count];
+		int sideB[count];
+
+		EightConnected(int ySize)
+		{
+			const int dx[count] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+			const int dy[count] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+
+			for (int i = 0; i < count; i++)
+			{
+				offsets[i] = dx[i] * ySize + dy[i];
+
+				//Diagonal parents combine the two straight directions
+				int back = 0;
+				if (dy[i] < 0) back |= Node::Direction::SOUTH;
+				if (dy[i] > 0) back |= Node::Direction::NORTH;
+				if (dx[i] > 0) back |= Node::Direction::WEST;
+				if (dx[i] < 0) back |= Node::Direction::EAST;
+				parents[i] = Node::Direction(back);
+
+				sideA[i] = dx[i] * ySize;
+				sideB[i] = dy[i];
+			}
+		}
+
+		template <class Layout>
+		bool passable(const Layout &layout, int current, int neighbour) const
+		{
+			if (neighbour < 4) return true;
+
+			return !(layout.isWall(current + sideA[neighbour]) && layout.isWall(current + sideB[neighbour]));
+		}
+	};
+
+	//Stops as soon as any target is reached
+	struct FirstTarget
+	{
+		static bool done(int /*targetsLeft*/) { return true; }
+	};
+
+	//Keeps going until every target has a distance
+	struct AllTargets
+	{
+		static bool done(int targetsLeft) { return targetsLeft == 0; }
+	};
+
+	//Fills in the distance to every reachable cell
+	struct FullField
+	{
+		static bool done(int /*targetsLeft*/) { return false; }
+	};
+
+	//Searches directly in the maze's nodes
+	class NodeLayout
+	{
+	public:
+		NodeLayout(Node *nodes, size_t /*count*/, std::vector<unsigned char> & /*buffer*/) : _nodes(nodes) {}
+
+		unsigned char state(int i) const
+		{
+			const Node &node = _nodes[i];
+			if (node.steps != -1) return State::VISITED;
+			if (node.type == Node::Type::UNSEARCHED) return State::OPEN;
+			if (node.type == Node::Type::TARGET) return State::TARGET;
+			if (node.type == Node::Type::WALL) return State::WALL;
+
+			return State::BLOCKED;
+		}
+
+		bool isWall(int i) const { return _nodes[i].type == Node::Type::WALL; }
+
+		void start(int i) { _nodes[i].steps = 0; }
+
+		void visit(int i, int steps, Node::Direction parent)
+		{
+			_nodes[i].type = Node::Type::SEARCHED;
+			_nodes[i].steps = steps;
+			_nodes[i].parent = parent;
+		}
+
+		void reach(int i, int steps, Node::Direction parent)
+		{
+			_nodes[i].steps = steps;
+			_nodes[i].parent = parent;
+		}
+
+		void finish(const std::vector<int> & /*frontier*/, const std::vector<size_t> & /*levels*/) {}
+
+	private:
+		Node *_nodes;
+	};
+
+	//Searches a plane of one byte per cell, so far more of the search fits in cache
+	//The results are copied back into the nodes of every visited cell once the search ends
+	class CompactLayout
+	{
+	public:
+		CompactLayout(Node *nodes, size_t count, std::vector<unsigned char> &buffer) : _nodes(nodes), _plane(buffer)
+		{
+			_plane.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				const Node &node = nodes[i];
+				if (node.steps != -1) _plane[i] = State::VISITED;
+				else if (node.type == Node::Type::UNSEARCHED) _plane[i] = State::OPEN;
+				else if (node.type == Node::Type::TARGET) _plane[i] = State::TARGET;
+				else if (node.type == Node::Type::WALL) _plane[i] = State::WALL;
+				else _plane[i] = State::BLOCKED;
+			}
+		}
+
+		unsigned char state(int i) const { return _plane[i]; }
+
+		bool isWall(int i) const { return _plane[i] == State::WALL; }
+
+		void start(int i) { _plane[i] = State::VISITED; }
+
+		void visit(int i, int /*steps*/, Node::Direction parent) { _plane[i] = State::VISITED | parent; }
+
+		void reach(int i, int steps, Node::Direction parent)
+		{
+			_plane[i] = State::VISITED | parent;
+			_nodes[i].steps = steps;
+			_nodes[i].parent = parent;
+		}
+
+		void finish(const std::vector<int> &frontier, const std::vector<size_t> &levels)
+		{
+			//Every cell in the frontier was visited in order, so its distance is the level it sits in
+			for (size_t level = 0; level + 1 < levels.size(); level++)
+			{
+				for (size_t i = levels[level]; i < levels[level + 1]; i++)
+				{
+					Node &node = _nodes[frontier[i]];
+					node.steps = level;
+
+					if (level == 0) continue;
+					node.type = Node::Type::SEARCHED;
+					node.parent = Node::Direction(_plane[frontier[i]] & ~State::VISITED);
+				}
+			}
+		}
+
+	private:
+		Node *_nodes;
+		std::vector<unsigned char> &_plane;
+	};
+
+	//Level synchronous breadth first search from every start in the workspace at once
+	//Returns the index of the first target reached, or -1 if none was
+	template <class Neighbourhood, class Stop, class Layout>
+	int solve(Node *nodes, int xSize, int ySize, int targetCount, SolverWorkspace &workspace)
+	{
+		const Neighbourhood neighbourhood(ySize);
+		Layout layout(nodes, (size_t)xSize * ySize, workspace.plane);
+
+		std::vector<int> &frontier = workspace.frontier;
+		frontier.clear();
+		for (int start : workspace.starts)
+		{
+			layout.start(start);
+			frontier.push_back(start);
+		}
+
+		//Frontier index where each level begins, plus the end of the last one
+		std::vector<size_t> &levels = workspace.levels;
+		levels.clear();
+		levels.push_back(0);
+
+		int reached = -1;
+		int targetsLeft = targetCount;
+		int steps = 0;
+
+		size_t head = 0;
+		size_t levelEnd = frontier.size();
+		while (head < frontier.size())
+		{
+			if (head == levelEnd)
+			{
+				levels.push_back(head);
+				levelEnd = frontier.size();
+				steps++;
+			}
+
+			int current = frontier[head++];
+
+			for (int n = 0; n < Neighbourhood::count; n++)
+			{
+				int next = current + neighbourhood.offsets[n];
+
+				unsigned char state = layout.state(next);
+				if (state >= State::WALL || !neighbourhood.passable(layout, current, n)) continue;
+
+				if (state == State::OPEN)
+				{
+					layout.visit(next, steps + 1, neighbourhood.parents[n]);
+					frontier.push_back(next);
+					continue;
+				}
+
+				layout.reach(next, steps + 1, neighbourhood.parents[n]);
+				if (reached == -1) reached = next;
+
+				if (Stop::done(--targetsLeft))
+				{
+					//Close off the level being expanded and the one being discovered
+					levels.push_back(levelEnd);
+					levels.push_back(frontier.size());
+					layout.finish(frontier, levels);
+					return reached;
+				}
+			}
+		}
+
+		levels.push_back(frontier.size());
+		layout.finish(frontier, levels);
+
+		return reached;
+	}
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "SolverWorkspace.h"
+
+void SolverWorkspace::reserve(size_t cells)
+{
+	frontier.reserve(cells);
+	plane.reserve(cells);
+	levels.reserve(cells);
+	stack.reserve(cells);
+	costs.reserve(cells);
+	parents.reserve(cells);
+	setSizes.reserve(cells);
+
+	//Weights are single digits, so there are never more than 10 buckets
+	//How full each one gets depends on the maze, so they warm up on the first weighted solve
+	if (buckets.size() < 10) buckets.resize(10);
+
+	track();
+}
+
+size_t SolverWorkspace::capacity() const
+{
+	size_t total = frontier.capacity() + plane.capacity() + levels.capacity() + starts.capacity() + stack.capacity() + buckets.capacity();
+	for (const std::vector<int> &bucket : buckets)
+	{
+		total += bucket.capacity();
+	}
+
+	total += costs.capacity() + parents.capacity() + setSizes.capacity() + stripCounts.capacity() + strips.capacity() + componentFlags.capacity();
+	total += stripStarts.capacity() + stripTargets.capacity();
+	for (const std::vector<int> &components : stripStarts)
+	{
+		total += components.capacity();
+	}
+	for (const std::vector<int> &components : stripTargets)
+	{
+		total += components.capacity();
+	}
+
+	return total;
+}
+
+void SolverWorkspace::track()
+{
+	//Buffers only ever grow, so any change in total capacity means something was allocated
+	size_t current = capacity();
+	if (current != _capacity) _allocations++;
+
+	_capacity = current;
+}
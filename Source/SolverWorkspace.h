@@ -0,0 +1,77 @@
+#ifndef SOLVER_WORKSPACE_H
+#define SOLVER_WORKSPACE_H
+
+#include <cstddef>
+#include <vector>
+
+class Maze;
+
+//Scratch buffers for generating, solving and tracing, reused between calls so a warm workspace never allocates
+//One workspace can be shared by many mazes of a similar size, as long as only one of them is searching at a time
+class SolverWorkspace
+{
+public:
+	//Grows every buffer up front for mazes of up to this many cells
+	void reserve(size_t cells);
+
+	//How many times a buffer had to grow, this stops changing once the workspace is warm
+	//Only growth of the workspace's own buffers is seen, plus whatever is reported through countAllocation,
+	//so memory allocated anywhere else, like a Path the caller passes in, is never counted
+	unsigned long long getAllocations() const { return _allocations; }
+
+	//Called by the maze once at the end of each operation, such as a generate, a solve or a whole stepped search,
+	//to notice any buffer that grew since the last call, several growths in one operation count once
+	void track();
+	//For growth the workspace can't see, like the maze's own grid
+	void countAllocation() { _allocations++; }
+
+	//Maze whose search the stepping state below belongs to
+	const Maze *owner = nullptr;
+
+	//Cell indices waiting to be expanded, everything before head has already been expanded
+	std::vector<int> frontier;
+	size_t head = 0;
+
+	//Dial's bucket queue for weighted mazes, only the first bucketCount buckets are in use
+	std::vector<std::vector<int>> buckets;
+	int bucketCount = 0;
+	int bucketCost = 0;
+	long long queued = 0;
+
+	//Compact search plane and level boundaries for the solver kernels
+	std::vector<unsigned char> plane;
+	std::vector<size_t> levels;
+
+	//Start cell indices of the current search
+	std::vector<int> starts;
+
+	//Depth first stack of cell indices used by generate
+	std::vector<int> stack;
+
+	//Cheapest known cost of each cell for searches between two cells, -1 everywhere between searches
+	std::vector<int> costs;
+
+	//Union-find parents and set sizes used to label connected components
+	std::vector<int> parents;
+	std::vector<int> setSizes;
+	//First column of each strip of a parallel pass, with the cell, edge and root counts of each strip
+	std::vector<int> strips;
+	std::vector<long long> stripCounts;
+	//Components holding starts and targets, found separately by each strip
+	std::vector<std::vector<int>> stripStarts;
+	std::vector<std::vector<int>> stripTargets;
+	//One flag per component
+	std::vector<unsigned char> componentFlags;
+
+	//Cell the stepping trace is at, -1 when no trace is running
+	int traceX = -1;
+	int traceY = -1;
+
+private:
+	size_t capacity() const;
+
+	size_t _capacity = 0;
+	unsigned long long _allocations = 0;
+};
+
+#endif
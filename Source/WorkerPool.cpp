@@ -0,0 +1,89 @@
+#include "WorkerPool.h"
+
+WorkerPool &WorkerPool::shared()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+WorkerPool::WorkerPool(int threads) : _busy(false), _next(0)
+{
+	for (int i = 1; i < threads; i++)
+	{
+		_workers.push_back(std::thread(&WorkerPool::work, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread &worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void WorkerPool::runTasks(int tasks, Call call, void *context)
+{
+	//Small loops, nested loops and loops started while another is running don't wait for the pool
+	if (tasks <= 1 || _workers.empty() || _busy.exchange(true))
+	{
+		for (int task = 0; task < tasks; task++)
+		{
+			call(context, task);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_call = call;
+		_context = context;
+		_tasks = tasks;
+		_next = 0;
+		_finished = 0;
+		_generation++;
+	}
+	_wake.notify_all();
+
+	for (int task = _next++; task < tasks; task = _next++)
+	{
+		call(context, task);
+	}
+
+	//Every worker has to finish with this loop before the next one can replace it
+	{
+		std::unique_lock<std::mutex> lock(_lock);
+		_done.wait(lock, [this]() { return _finished == (int)_workers.size(); });
+	}
+
+	_busy = false;
+}
+
+void WorkerPool::work()
+{
+	unsigned long long seen = 0;
+
+	std::unique_lock<std::mutex> lock(_lock);
+	while (true)
+	{
+		_wake.wait(lock, [&]() { return _stop || _generation != seen; });
+		if (_stop) return;
+
+		seen = _generation;
+		lock.unlock();
+
+		for (int task = _next++; task < _tasks; task = _next++)
+		{
+			_call(_context, task);
+		}
+
+		lock.lock();
+		if (++_finished == (int)_workers.size()) _done.notify_one();
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//Threads started once and shared by every parallel loop, so a loop costs a wake up rather than a thread start
+//Only one loop runs on the pool at a time, a loop started while it is busy, or from inside another loop, runs on its caller
+class WorkerPool
+{
+public:
+	//One thread per hardware thread, counting the thread that calls into it
+	static WorkerPool &shared();
+
+	explicit WorkerPool(int threads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	int getThreadCount() const { return (int)_workers.size() + 1; }
+
+	//Calls work(task) once for every task in [0, tasks), returning once all of them are done
+	//The caller takes tasks too, so tasks never wait for a thread that has nothing else to do
+	template <class Work>
+	void run(int tasks, Work &&work)
+	{
+		typedef typename std::remove_reference<Work>::type Function;
+		runTasks(tasks, [](void *context, int task) { (*(Function *)context)(task); }, (void *)&work);
+	}
+
+	//Calls work(i) for every i in [0, count), handing out one index at a time so uneven items balance out
+	template <class Work>
+	void forEach(int count, Work &&work)
+	{
+		struct None {};
+		forEachWith<None>(count, [&](int i, None &) { work(i); });
+	}
+
+	//Same as forEach, with a State for each thread taking part, for scratch space reused between items
+	template <class State, class Work>
+	void forEachWith(int count, Work &&work)
+	{
+		std::atomic<int> next(0);
+		run(std::min(count, getThreadCount()), [&](int)
+		{
+			State state;
+			for (int i = next++; i < count; i = next++)
+			{
+				work(i, state);
+			}
+		});
+	}
+
+private:
+	typedef void (*Call)(void *context, int task);
+
+	void runTasks(int tasks, Call call, void *context);
+	void work();
+
+	std::vector<std::thread> _workers;
+
+	//Set while a loop is running, loops that find it set run on their caller instead of waiting
+	std::atomic<bool> _busy;
+
+	//The current loop, only changed while every worker is waiting for the next generation
+	std::mutex _lock;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	unsigned long long _generation = 0;
+	Call _call = nullptr;
+	void *_context = nullptr;
+	int _tasks = 0;
+	std::atomic<int> _next;
+	int _finished = 0;
+	bool _stop = false;
+};
+
+#endif